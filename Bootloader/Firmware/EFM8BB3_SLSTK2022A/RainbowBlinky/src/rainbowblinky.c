@@ -60,19 +60,13 @@ const SI_SEGMENT_VARIABLE(colorNames[], char*, SI_SEG_CODE) =
 // Global Variables - Menu String Constants
 /////////////////////////////////////////////////////////////////////////////
 
-const SI_SEGMENT_VARIABLE(LED_INTENSITY_BREATHE[256], uint8_t, SI_SEG_CODE) =
+// First half of the breathe curve. A period is 128 steps and mirrors about
+// step 64, the 256 step counter runs it twice. See GetBreatheIntensity().
+const SI_SEGMENT_VARIABLE(LED_INTENSITY_BREATHE[65], uint8_t, SI_SEG_CODE) =
 {
   221,221,220,218,216,213,210,206,202,197,192,187,181,175,169,162,156,149,142,
   136,129,122,116,109,103,97,91,85,79,74,69,64,59,55,50,46,42,39,35,32,29,26,
-  24,21,19,17,15,13,11,10,8,7,6,5,4,3,2,2,1,1,0,0,0,0,0,0,0,0,0,1,1,2,2,3,4,5
-  ,6,7,8,10,11,13,15,17,19,21,24,26,29,32,35,39,42,46,50,55,59,64,69,74,79,85,
-  91,97,103,109,116,122,129,136,142,149,156,162,169,175,181,187,192,197,202,
-  206,210,213,216,218,220,221,221,221,220,218,216,213,210,206,202,197,192,187,
-  181,175,169,162,156,149,142,136,129,122,116,109,103,97,91,85,79,74,69,64,59,
-  55,50,46,42,39,35,32,29,26,24,21,19,17,15,13,11,10,8,7,6,5,4,3,2,2,1,1,0,0,
-  0,0,0,0,0,0,0,1,1,2,2,3,4,5,6,7,8,10,11,13,15,17,19,21,24,26,29,32,35,39,42,
-  46,50,55,59,64,69,74,79,85,91,97,103,109,116,122,129,136,142,149,156,162,
-  169,175,181,187,192,197,202,206,210,213,216,218,220,221
+  24,21,19,17,15,13,11,10,8,7,6,5,4,3,2,2,1,1,0,0,0,0,0
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -178,9 +172,22 @@ void RainbowBlinky_Update()
   }
 }
 
+// Rebuild the 128 step breathe period from its first half
+uint8_t GetBreatheIntensity(uint8_t index)
+{
+  index &= 127;
+
+  if (index > 64)
+  {
+    index = 128 - index;
+  }
+
+  return LED_INTENSITY_BREATHE[index];
+}
+
 void RainbowBlinky_UpdateLED()
 {
-  uint8_t intensity = LED_INTENSITY_BREATHE[ledIntensityCounter] >> 3;
+  uint8_t intensity = GetBreatheIntensity(ledIntensityCounter) >> 3;
 
   RGB_SetColor(ledColor, intensity);
   ledIntensityCounter++;
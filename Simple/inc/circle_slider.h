@@ -10,7 +10,63 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #define MAIN_FRAME_RATE 50
-#define MIN_SUM_TOUCH   30
+// Touch deltas are normalized per pad so that a finger squarely on any
+// pad reads PAD_NORMALIZED_PEAK. MIN_SUM_TOUCH and the multi-touch
+// thresholds below are in these units.
+#define PAD_NORMALIZED_PEAK   64
+
+// Peak delta assumed for a pad until one has been learned
+// (DEF_AVERAGE_TOUCH_DELTA >> 8)
+#define PAD_DEFAULT_PEAK      46
+
+// Lower bound of a learned peak so noise can never inflate a pad's gain
+#define PAD_PEAK_MIN          16
+
+// Single-touch frames on a pad below its peak before the peak drops by one
+#define PAD_PEAK_DECAY_FRAMES 128
+
+// Rise of a learned peak above the stored value that triggers a flash save
+#define PAD_PEAK_SAVE_STEP    4
+
+// Fall of a learned peak below the stored value that triggers a flash save,
+// 16 decay steps are about 40 s of single touches at 50 frames a second
+#define PAD_PEAK_SAVE_DROP    16
+
+// Milliseconds the wheel must stay untouched before learned peaks are saved
+#define PAD_PEAK_SAVE_DELAY   2000
+
+#define MIN_SUM_TOUCH   42
+
+// Sum of touch deltas above which the wheel holds more than one finger
+#define MAX_SUM_TOUCH         125
+
+// Pad delta that only a finger resting squarely on that pad reaches.
+// Two pads at or above it at once means two touches.
+#define TWO_TOUCH_PAD_DELTA   45
+
+// Weakest pad delta above which all three pads count as loaded
+#define AMBIGUOUS_PAD_DELTA   17
+
+// Frames a single touch must persist after a multi-touch before the
+// LED follows it again
+#define TWO_TOUCH_HOLDOFF     4
+
+// Change in spread that reports a pinch or spread gesture
+#define SPREAD_GESTURE_STEP   48
+
+// Wheel touch classification, see circle_slider_getState()
+#define SLIDER_STATE_NONE       0
+#define SLIDER_STATE_SINGLE     1
+#define SLIDER_STATE_TWO_TOUCH  2
+#define SLIDER_STATE_AMBIGUOUS  3
+
+// circle_slider_getAngle() without a settled single touch
+#define SLIDER_NO_ANGLE         0xFFFF
+
+// Two finger gestures, see circle_slider_getGesture()
+#define SLIDER_GESTURE_NONE     0
+#define SLIDER_GESTURE_PINCH    1
+#define SLIDER_GESTURE_SPREAD   2
 
 /////////////////////////////////////////////////////////////////////////////
 // Macros
@@ -26,6 +82,15 @@
 // Prototypes
 /////////////////////////////////////////////////////////////////////////////
 
+void circle_slider_init(bool stored);
 void circle_slider_main();
+void circle_slider_ledOff(void);
+void circle_slider_setClockShift(uint8_t shift);
+void circle_slider_savePeaks(void);
+void circle_slider_storePeaks(void);
+uint8_t circle_slider_getState(void);
+uint16_t circle_slider_getAngle(void);
+uint8_t circle_slider_getSpread(void);
+uint8_t circle_slider_getGesture(void);
 
 #endif /* CIRCLE_SLIDER_H_ */
@@ -0,0 +1,38 @@
+/**
+ * @file clock.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * SYSCLK is the low power oscillator divided by 1 << Clock_Shift. This is
+	 * the shift used when nobody asks for the fast clock, set it to 0 to
+	 * always run fast.
+	 */
+	#define CLOCK_SLOW_SHIFT	2
+
+	/**
+	 * low power oscillator frequency in Hz, SYSCLK at the fast level
+	 */
+	#define CLOCK_FAST_HZ		20000000L
+
+	/**
+	 * clock levels for Clock_Request()
+	 */
+	#define CLOCK_SLOW			0
+	#define CLOCK_FAST			1
+
+	/**
+	 * current SYSCLK divider shift, for the timer code
+	 */
+	extern uint8_t Clock_Shift;
+
+	void Clock_Init(void);
+	void Clock_Request(uint8_t level);
+	void Clock_Release(uint8_t level);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file frame.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * frame rate while the wheel or a button is touched
+	 */
+	#define FRAME_RATE_ACTIVE	MAIN_FRAME_RATE
+
+	/**
+	 * frame rate the governor slows down to once nothing is touched
+	 */
+	#define FRAME_RATE_IDLE		20
+
+	/**
+	 * untouched frames the active rate is kept after a release, plus one for
+	 * every 8 points of touch activity
+	 */
+	#define FRAME_HOLD_FRAMES	10
+
+	/**
+	 * touch activity added by every touched frame, out of 255
+	 */
+	#define FRAME_ACTIVITY_STEP	8
+
+	/**
+	 * longest time in ms a new touch may take to register
+	 */
+	#define FRAME_MAX_LATENCY	120
+
+	void Frame_Init(void);
+	void Frame_Begin(void);
+	bool Frame_End(bool active);
+	uint8_t Frame_GetPeriod(void);
+	void Frame_SetActivePeriod(uint8_t period);
+	uint8_t Frame_GetActivePeriod(void);
+
+	uint16_t Frame_GetWorst(void);
+	void Frame_ClearStats(void);
+	void Frame_ScanDone(uint32_t start, uint16_t duration);
+
+	/**
+	 * tuning figures and scan records, only built with the serial
+	 * interface that reads them
+	 */
+	uint16_t Frame_GetJitter(void);
+	uint16_t Frame_GetDuty(void);
+	uint16_t Frame_GetCount(void);
+	uint16_t Frame_GetSaved(void);
+	uint16_t Frame_GetSequence(void);
+	uint32_t Frame_GetScanStart(void);
+	uint16_t Frame_GetScanDuration(void);
+
+#endif
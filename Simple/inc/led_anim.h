@@ -0,0 +1,32 @@
+/**
+ * @file led_anim.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __LED_ANIM_H__
+#define __LED_ANIM_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * milliseconds between two animation frames
+	 */
+	#define LED_ANIM_FRAME_MS	10
+
+	/**
+	 * effect IDs for LedAnim_Start()
+	 */
+	#define LED_ANIM_OFF		0
+	#define LED_ANIM_ON			1
+	#define LED_ANIM_FADE_IN	2
+	#define LED_ANIM_FADE_OUT	3
+	#define LED_ANIM_BLINK		4
+	#define LED_ANIM_FLASH		5
+	#define LED_ANIM_BREATHE	6
+	#define LED_ANIM_COUNT		7
+
+	void LedAnim_Init(void);
+	void LedAnim_Start(uint8_t led, uint8_t effect);
+	void LedAnim_Tick(void);
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * @file led_pwm.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __LED_PWM_H__
+#define __LED_PWM_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * brightness resolution in bits, anything from 6 to 8
+	 */
+	#define LED_PWM_BITS		8
+
+	/**
+	 * brightness that keeps a LED fully on. 0 keeps it fully off.
+	 */
+	#define LED_PWM_MAX			((1 << LED_PWM_BITS) - 1)
+
+	/**
+	 * Timer 2 counts (SYSCLK / 12) per brightness step at the fast clock.
+	 * This keeps the PWM period at 8192 counts, about 200Hz, whatever the
+	 * resolution. Must stay at or above CLOCK_SLOW_SHIFT.
+	 */
+	#define LED_PWM_STEP_SHIFT	(13 - LED_PWM_BITS)
+
+	/**
+	 * Set to 1 to measure how much time the PWM interrupt takes, read over
+	 * serial with the DIAGNOSTIC_LED_ISR_ diagnostics
+	 */
+	#define LED_PWM_PROFILE		0
+
+	/**
+	 * LED index as used by LedPwm_Set()
+	 */
+	#define LED_PWM_LED1		0
+	#define LED_PWM_LED2		1
+	#define LED_PWM_LED3		2
+	#define LED_PWM_LED4		3
+	#define LED_PWM_LED5		4
+	#define LED_PWM_COUNT		5
+
+	void LedPwm_Init(void);
+	void LedPwm_Set(uint8_t led, uint8_t level);
+	void LedPwm_Update(void);
+	void LedPwm_SetClockShift(uint8_t shift);
+
+#if LED_PWM_PROFILE
+	uint16_t LedPwm_GetIsrLoad(uint16_t *worstCase);
+#endif
+
+#endif
@@ -7,12 +7,34 @@
 #ifndef __MAIN_H__
 #define __MAIN_H__
 
+	/**
+	 * Set to 1 to run the serial interface: UART0 on P0.4 (TX) and P0.5 (RX),
+	 * the profiler output and the host commands, updated once a frame.
+	 *
+	 * lib/efm8sb1/cslib/serial_interface is excluded from the build so its
+	 * buffers cost no XRAM. Remove it from the excluded source paths as
+	 * well, in both build configurations (Properties > C/C++ General >
+	 * Paths and Symbols > Source Location, or the sourceEntries of
+	 * .cproject).
+	 */
+	#define COMM_ENABLE	0
+
 	#include <SI_EFM8SB1_Register_Enums.h>
 	#include <stdlib.h>
 	#include "InitDevice.h"
 	#include "circle_slider.h"
 
 	#include "tick.h"
+	#include "settings.h"
+	#include "led_pwm.h"
+	#include "led_anim.h"
+	#include "scheduler.h"
+	#include "touch_event.h"
+	#include "frame.h"
+	#include "clock.h"
+	#include "power.h"
+	#include "param.h"
+	#include "recorder.h"
 
 
 #endif
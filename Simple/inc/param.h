@@ -0,0 +1,68 @@
+/**
+ * @file param.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __PARAM_H__
+#define __PARAM_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * parameter ids
+	 */
+	#define PARAM_ACTIVE_DELTA	0	// CSLIB_activeSensorDelta
+	#define PARAM_INACTIVE_DELTA	1	// CSLIB_inactiveSensorDelta
+	#define PARAM_DEBOUNCE		2	// CSLIB_buttonDebounce
+	#define PARAM_ACTIVE_PERIOD	3	// frame period in ms while touched
+	#define PARAM_GAIN		4	// CS0 gain of each channel
+	#define PARAM_ACCUMULATION	5	// CS0 accumulation of each channel
+	#define PARAM_COUNT		6
+
+	/**
+	 * value types
+	 */
+	#define PARAM_U8		1
+	#define PARAM_U16		2
+
+	/**
+	 * what Param_Describe() returns
+	 */
+	#define PARAM_INFO_TYPE		0
+	#define PARAM_INFO_CHANNELS	1
+	#define PARAM_INFO_MIN		2
+	#define PARAM_INFO_MAX		3
+
+	/**
+	 * status returned by the registry
+	 */
+	#define PARAM_OK		0
+	#define PARAM_BAD_ID		1	// no such id, channel or info item
+	#define PARAM_BAD_VALUE		2	// out of range
+
+	/**
+	 * ms from Param_Commit() to the flash write, leaves time for the reply
+	 * to go out before interrupts are stopped for the page erase
+	 */
+	#define PARAM_SAVE_DELAY	100
+
+	/**
+	 * one registry entry
+	 */
+	typedef struct {
+		uint8_t type;		// PARAM_U8 or PARAM_U16
+		uint8_t channels;	// 1, or DEF_NUM_SENSORS for one value per channel
+		uint16_t min;
+		uint16_t max;
+	} Param_t;
+
+	void Param_Init(bool stored);
+	uint8_t Param_Get(uint8_t id, uint8_t channel, uint16_t *value);
+	uint8_t Param_Set(uint8_t id, uint8_t channel, uint16_t value);
+	uint8_t Param_Describe(uint8_t id, uint8_t item, uint16_t *value);
+	void Param_Commit(void);
+	bool Param_Save(void);
+	bool Param_IsChanged(void);
+	void Param_Store(void);
+
+#endif
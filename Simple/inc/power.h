@@ -0,0 +1,49 @@
+/**
+ * @file power.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __POWER_H__
+#define __POWER_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * Set to 1 to keep the residency accounting and the wake up latency.
+	 * They are only read over serial, so this also needs COMM_ENABLE, and
+	 * cost about 40 bytes of RAM and some time in the idle and scan paths.
+	 */
+	#define POWER_STATS_ENABLE	0
+
+	/**
+	 * power states the time is split between
+	 */
+	#define POWER_ACTIVE		0
+	#define POWER_IDLE		1
+	#define POWER_SUSPEND		2
+	#define POWER_SLEEP		3
+	#define POWER_STATE_COUNT	4
+
+	/**
+	 * typical supply current of each state in uA, from the EFM8SB1 data
+	 * sheet for a core that mostly runs at LPOSC/4. Measure a unit and adjust.
+	 */
+	#define POWER_CURRENT_ACTIVE	1800
+	#define POWER_CURRENT_IDLE	650
+	#define POWER_CURRENT_SUSPEND	120
+	#define POWER_CURRENT_SLEEP	1
+
+	/**
+	 * battery capacity in uAh, a CR2032 coin cell
+	 */
+	#define POWER_BATTERY_UAH	220000L
+
+	void Power_Account(uint8_t state, uint32_t micros);
+	void Power_Update(void);
+
+	uint16_t Power_GetShare(uint8_t state);
+	uint16_t Power_GetAverageCurrent(void);
+	uint32_t Power_GetBatteryHours(void);
+	void Power_ClearStats(void);
+
+#endif
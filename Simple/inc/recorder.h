@@ -0,0 +1,84 @@
+/**
+ * @file recorder.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+	#include <si_toolchain.h>
+	#include "cslib_config.h"
+
+	/**
+	 * Set to 1 to keep the flight recorder. It takes about 130 bytes of
+	 * XRAM and is dumped with the host commands of command_interface.c, so
+	 * it also needs COMM_ENABLE.
+	 */
+	#define RECORDER_ENABLE		0
+
+	/**
+	 * frames and events kept, both must be powers of two
+	 */
+	#define RECORDER_FRAMES		8
+	#define RECORDER_EVENTS		4
+
+	/**
+	 * a frame keeps PROCESS above the baseline divided by 2^RECORDER_SHIFT,
+	 * 64 counts a step puts the default thresholds near 50 and 80
+	 */
+	#define RECORDER_SHIFT		6
+
+	/**
+	 * a debounced touch released within this many frames is a false touch,
+	 * must be less than RECORDER_FRAMES - 1
+	 */
+	#define RECORDER_GLITCH_FRAMES	3
+
+	/**
+	 * what froze the recorder
+	 */
+	#define RECORDER_TRIGGER_NONE		0	// still recording
+	#define RECORDER_TRIGGER_FALSE_TOUCH	1
+	#define RECORDER_TRIGGER_HOST		2	// a missed touch, or a dump request
+
+	/**
+	 * tells a recording kept across a reset from random XRAM
+	 */
+	#define RECORDER_MAGIC		0x5AC3
+
+	typedef struct {
+		uint8_t sequence;		// Frame_GetSequence() low byte
+		uint16_t debounce;		// debounced sensors, a bit each
+		uint8_t delta[DEF_NUM_SENSORS];	// see RECORDER_SHIFT, 255 at most
+	} RecorderFrame_t;
+
+	typedef struct {
+		uint8_t sequence;		// frame the event was read in
+		uint8_t type;			// TOUCH_EVENT_ type
+		uint8_t source;			// button
+	} RecorderEvent_t;
+
+	typedef struct {
+		uint16_t magic;
+		uint8_t trigger;
+		uint8_t frameHead;		// both count up freely
+		uint8_t eventHead;
+		uint16_t baseline[DEF_NUM_SENSORS];	// at the last frame recorded
+		RecorderFrame_t frame[RECORDER_FRAMES];
+		RecorderEvent_t event[RECORDER_EVENTS];
+	} Recorder_t;
+
+	extern SI_SEGMENT_VARIABLE(Recorder, Recorder_t, SI_SEG_XDATA);
+
+	void Recorder_Init(void);
+	void Recorder_Update(void);
+	void Recorder_Event(uint8_t type, uint8_t source);
+	void Recorder_Trigger(uint8_t trigger);
+	void Recorder_Arm(void);
+
+	uint8_t Recorder_GetFrameCount(void);
+	RecorderFrame_t xdata *Recorder_GetFrame(uint8_t index);
+	uint8_t Recorder_GetEventCount(void);
+	RecorderEvent_t xdata *Recorder_GetEvent(uint8_t index);
+
+#endif
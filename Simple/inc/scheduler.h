@@ -0,0 +1,43 @@
+/**
+ * @file scheduler.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * Application tasks. The ID is also the priority, when several tasks
+	 * are due the lowest ID runs first.
+	 */
+	#define TASK_FRAME				0
+	#define TASK_SETTINGS			1
+	#define SCHEDULER_TASK_COUNT	2
+
+	/**
+	 * number of timer wheel slots, must be a power of two
+	 */
+	#define SCHEDULER_WHEEL_SIZE	4
+
+	void Scheduler_Init(void);
+	void Scheduler_Every(uint8_t task, uint16_t period, uint8_t deadline);
+	void Scheduler_Once(uint8_t task, uint16_t delay);
+	void Scheduler_Stop(uint8_t task);
+	void Scheduler_Run(void);
+
+	uint8_t Scheduler_GetMissed(uint8_t task);
+
+	/**
+	 * load figures, only built with the serial interface that reads them
+	 */
+	uint16_t Scheduler_GetLoad(uint8_t task);
+	void Scheduler_ClearLoad(void);
+
+	/**
+	 * provided by the application, runs one task
+	 */
+	void Scheduler_RunTask(uint8_t task);
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @file settings.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+	#include <si_toolchain.h>
+	#include "cslib_config.h"
+
+	/**
+	 * Flash page that holds the settings. This is the last application page,
+	 * just below the page occupied by the UART bootloader. FLASH_RESERVE.A51
+	 * keeps the linker out of both.
+	 */
+	#define SETTINGS_FLASH_ADDRESS	0x1C00
+
+	/**
+	 * Bump this whenever Settings_t changes so older records are ignored
+	 */
+	#define SETTINGS_VERSION	2
+
+	/**
+	 * Everything the firmware keeps across power cycles
+	 */
+	typedef struct {
+		uint8_t version;
+		uint8_t padPeak[3];	// learned full touch delta of each wheel pad
+		uint16_t activeDelta;	// tuned parameters, see param.h
+		uint16_t inactiveDelta;
+		uint8_t debounce;
+		uint8_t activePeriod;
+		uint8_t gain[DEF_NUM_SENSORS];
+		uint8_t accumulation[DEF_NUM_SENSORS];
+		uint8_t checksum;	// must stay the last member
+	} Settings_t;
+
+	/**
+	 * the record in flash, only meaningful when Settings_Init() returned true
+	 */
+	#define SETTINGS_STORED	((Settings_t code *)SETTINGS_FLASH_ADDRESS)
+
+	bool Settings_Init(void);
+	void Settings_Put(uint8_t code *field, uint8_t value);
+	void Settings_Save(void);
+
+#endif
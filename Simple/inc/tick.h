@@ -6,8 +6,44 @@
 #ifndef __TICK_H_
 #define __TICK_H_
 
+	#include <si_toolchain.h>
+
+	/**
+	 * Timer 3 reload value at the fast clock, it counts SYSCLK / 12 and
+	 * overflows every 1ms
+	 */
+	#define TICK_RELOAD			0xF97D
+
+	/**
+	 * Timer 3 counts in a tick at the fast clock
+	 */
+	#define TICK_COUNTS_PER_MS	(0x10000 - TICK_RELOAD)
+
+	/**
+	 * no limit on how long the core may sleep
+	 */
+	#define TICK_NO_LIMIT		0xFFFF
+
 	void Tick_Init(void);
-	uint16_t Tick_GetCount();
+	uint32_t Tick_GetCount(void);
+	uint32_t Tick_Elapsed(uint32_t since);
+	bool Tick_IsDue(uint32_t deadline);
+	uint32_t Tick_GetMicros(void);
 	void Tick_Wait(uint16_t ms);
+	void Tick_Idle(void);
+	uint32_t Tick_TakeIdleMicros(void);
+
+	void Tick_SetSleepLimit(uint16_t ms);
+	uint16_t Tick_GetSleepLimit(void);
+	void Tick_Suspend(void);
+	void Tick_Resume(uint16_t ms);
+	void Tick_AddSuspend(uint16_t micros);
+	void Tick_SetClockShift(uint8_t shift);
+	uint32_t Tick_GetSleptMicros(void);
+
+	/**
+	 * only built with the serial interface, for the scheduler load
+	 */
+	uint32_t Tick_GetStoppedMicros(void);
 
 #endif
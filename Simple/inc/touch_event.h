@@ -0,0 +1,55 @@
+/**
+ * @file touch_event.h
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ */
+#ifndef __TOUCH_EVENT_H__
+#define __TOUCH_EVENT_H__
+
+	#include <si_toolchain.h>
+
+	/**
+	 * sensors reported as buttons, TOUCH_EVENT_FIRST_SENSOR is button 0
+	 */
+	#define TOUCH_EVENT_FIRST_SENSOR	3
+	#define TOUCH_EVENT_BUTTONS			6
+
+	/**
+	 * timing in TouchEvent_Update() calls, made once a frame. A touched
+	 * button keeps the frames at FRAME_RATE_ACTIVE (20ms a frame), so hold
+	 * and repeat are exact. The frame period only starts to grow
+	 * FRAME_HOLD_FRAMES after a release, which stretches the double tap
+	 * window by a few ms at most.
+	 */
+	#define TOUCH_EVENT_HOLD_FRAMES		40
+	#define TOUCH_EVENT_REPEAT_FRAMES	10
+	#define TOUCH_EVENT_DOUBLE_FRAMES	15
+
+	/**
+	 * number of events the queue holds, must be a power of two. The queue
+	 * is read in the frame that fills it, a press and double tap on two
+	 * buttons at once fill it and anything more counts as dropped.
+	 */
+	#define TOUCH_EVENT_QUEUE_SIZE		4
+
+	/**
+	 * event types
+	 */
+	#define TOUCH_EVENT_PRESS			0
+	#define TOUCH_EVENT_RELEASE			1
+	#define TOUCH_EVENT_HOLD			2
+	#define TOUCH_EVENT_REPEAT			3
+	#define TOUCH_EVENT_DOUBLE_TAP		4
+
+	typedef struct {
+		uint8_t type;
+		uint8_t button;
+		uint16_t time;		// Tick_GetCount() low 16 bits
+	} TouchEvent_t;
+
+	void TouchEvent_Init(void);
+	void TouchEvent_Update(void);
+	bool TouchEvent_Get(TouchEvent_t *event);
+	uint8_t TouchEvent_GetDropped(void);
+
+#endif
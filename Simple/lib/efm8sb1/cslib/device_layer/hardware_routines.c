@@ -8,6 +8,8 @@
 #include "cslib.h"
 
 #include "hardware_routines.h"
+#include "low_power_config.h"
+#include "power.h"
 #include "cslib_hwconfig.h"
 #include "SI_EFM8SB1_Defs.h"
 
@@ -82,15 +84,16 @@ void setAccumulation(uint8_t accumulation)
 // Assumes that the performance characteristics of the sensor have already
 // been configured.  Enables the sensor, starts a scan, blocks until
 // the scan is complete.
-// Note that this version of executeConversion() allows for a retrieval
-// of sensor data from the serial port through a call to getU16().  This
-// is a compile-time switch.
 //
 uint16_t executeConversion(void)
 {
 
       SI_UU16_t scanResult;
 
+#if POWER_STATS_ENABLE
+      lowPowerMarkScan();
+#endif
+
       CS0CN0 = 0x88;                       // Enable CS0, Enable Digital Comparator
 
       CS0CN0 &= ~0x20;                     // Clear the CS0 INT flag
@@ -143,6 +146,33 @@ void configureSensorForActiveMode(void)
 // of the library routines.
 //
 uint16_t scanSensor(uint8_t nodeIndex)
+{
+   uint16_t result;
+
+   if(nodeIndex == 0)
+   {
+      lowPowerScanBegin();
+   }
+
+   result = convertSensor(nodeIndex);
+
+   if(nodeIndex == DEF_NUM_SENSORS - 1)
+   {
+      lowPowerScanEnd();
+   }
+
+   return result;
+}
+
+//-----------------------------------------------------------------------------
+// convertSensor
+//-----------------------------------------------------------------------------
+//
+// Configures CS0 with the controls of one sensor node and returns one
+// conversion of it.  Unlike scanSensor(), it isn't counted as part of a
+// scan, so it can be used outside CSLIB_update().
+//
+uint16_t convertSensor(uint8_t nodeIndex)
 {
    setMux(CSLIB_techSpec[nodeIndex].mux);
    setGain(CSLIB_techSpec[nodeIndex].gain);
@@ -17,6 +17,9 @@ uint16_t scanSensor(uint8_t);
 void configureSensorForActiveMode(void);
 void nodeInit(uint8_t sensor_index);
 
+// One conversion of a sensor outside of a library scan
+uint16_t convertSensor(uint8_t nodeIndex);
+
 typedef struct
 {
    uint8_t mux;
@@ -12,6 +12,10 @@
 #include "SI_EFM8SB1_Defs.h"
 #include "low_power_config.h"
 #include "cslib_hwconfig.h"
+#include "tick.h"
+#include "clock.h"
+#include "power.h"
+#include "frame.h"
 xdata uint8_t timerTick = 0;
 
 
@@ -32,6 +36,9 @@ void configureRTCSleepMode(void);
 uint8_t updateRTCFlags(void);
 void configureCS0SleepMode(void);
 void configurePortsSleepMode(void);
+uint32_t RTC_GetCurrentTime(void);
+uint16_t RTC_countsToMs(uint32_t counts);
+uint32_t RTC_countsToMicros(uint32_t counts);
 
 
 //-----------------------------------------------------------------------------
@@ -44,6 +51,35 @@ SI_SEGMENT_VARIABLE(RTC_RTC0CNLocal, uint8_t, SI_SEG_DATA);
 
 SI_SEGMENT_VARIABLE(RTC_clkFreq, uint16_t, SI_SEG_XDATA);
 
+// Alarm value written by RTC_setAlarmPeriod(), the RTC counts up to it and
+// restarts from zero
+SI_SEGMENT_VARIABLE(RTC_alarmPeriod, uint32_t, SI_SEG_XDATA);
+
+// RTC counts left over from the last conversion to milliseconds
+SI_SEGMENT_VARIABLE(RTC_countsResidue, uint16_t, SI_SEG_XDATA);
+
+// Alarm period in ms, and set while it is the active mode period, so
+// enterLowPowerState() can follow CSLIB_activeModePeriod
+SI_SEGMENT_VARIABLE(RTC_alarmMs, uint16_t, SI_SEG_DATA);
+SI_SEGMENT_VARIABLE(RTC_activeMode, uint8_t, SI_SEG_DATA);
+
+#if POWER_STATS_ENABLE
+// RTC time of the last wake up, set until the first scan after it starts
+SI_SEGMENT_VARIABLE(RTC_wakeTime, uint32_t, SI_SEG_XDATA);
+SI_SEGMENT_VARIABLE(RTC_wakePending, uint8_t, SI_SEG_DATA);
+
+// Wake up to first scan latency in microseconds, last and worst seen
+xdata uint16_t wakeLatency = 0;
+xdata uint16_t wakeLatencyWorst = 0;
+#endif
+
+// RTC and Timer 3 time at the start of the running scan, see lowPowerScanEnd()
+SI_SEGMENT_VARIABLE(RTC_scanStart, uint32_t, SI_SEG_XDATA);
+SI_SEGMENT_VARIABLE(RTC_scanStartMicros, uint32_t, SI_SEG_XDATA);
+
+// Reset pin wake up delay loop count, at least 15us at the full clock
+#define RESET_WAKE_DELAY   80
+
 // Variables used for the RTC interface
 uint8_t PMU_PMU0CFLocal;                       // Holds the desired Wake-up sources
 
@@ -74,8 +110,14 @@ void readyRegistersForSleep(void)
 
 
    registerSaveState.CLKSELsave = CLKSEL;
-   CLKSEL = 0x14;
-   while (!(CLKSEL & 0x80));
+
+   // Drop to LPOSC/2 only when running faster, between scans the clock is
+   // normally on LPOSC/4 already and there is nothing to wait for on wake up
+   if(((CLKSEL & 0x07) != 0x04) || ((CLKSEL & 0x70) < 0x10))
+   {
+      CLKSEL = 0x14;
+      while (!(CLKSEL & 0x80));
+   }
 
    registerSaveState.P0MDINsave = P0MDIN;
    registerSaveState.P1MDIN_save = P1MDIN;
@@ -93,12 +135,16 @@ void restoreRegistersFromSleep(void)
    uint8_t SFRPAGEsave = SFRPAGE;
    SFRPAGE = LEGACY_PAGE;
 
-   CLKSEL = registerSaveState.CLKSELsave;
-   while (!(CLKSEL & 0x80));
-
+   // The sensor pins first, the next scan needs them
    P0MDIN = registerSaveState.P0MDINsave;
    P1MDIN = registerSaveState.P1MDIN_save;
    XBR1 = registerSaveState.XBR1save;
+
+   if((CLKSEL & 0x77) != (registerSaveState.CLKSELsave & 0x77))
+   {
+      CLKSEL = registerSaveState.CLKSELsave;
+      while (!(CLKSEL & 0x80));
+   }
    SFRPAGE = SFRPAGEsave;
 }
 //-----------------------------------------------------------------------------
@@ -107,8 +153,48 @@ void restoreRegistersFromSleep(void)
 //
 // Enter low power sleep mode.
 //
+// The 1ms tick is stopped for the sleep and moved on by the time the RTC
+// measured on wake up. The alarm is brought forward if a scheduled task is
+// due before the next scan.
+//
+// The frame governor changes CSLIB_activeModePeriod on the fly.  The library
+// only reloads the alarm on a change of mode, so a new active period is
+// picked up here, on the first sleep after it was set.
+//
 void enterLowPowerState(void)
 {
+   uint32_t sleepStart;
+   uint32_t sleepEnd;
+   uint32_t alarm;
+   uint32_t limit;
+   uint16_t limitMs = Tick_GetSleepLimit();
+
+   // A task is already due, don't sleep at all
+   if(limitMs == 0)
+   {
+      return;
+   }
+
+   if(RTC_activeMode && (RTC_alarmMs != CSLIB_activeModePeriod))
+   {
+      RTC_setAlarmPeriod(CSLIB_activeModePeriod);
+   }
+
+   alarm = RTC_alarmPeriod;
+   sleepStart = RTC_GetCurrentTime();
+
+   if(limitMs != TICK_NO_LIMIT)
+   {
+      limit = sleepStart + ((RTCCLK * (uint32_t)limitMs) / 1000L);
+
+      if(limit < alarm)
+      {
+         alarm = limit;
+         RTC_writeAlarm(alarm);
+      }
+   }
+
+   Tick_Suspend();
    readyRegistersForSleep();
 
    // Enable the Flash read one-shot timer
@@ -125,10 +211,155 @@ void enterLowPowerState(void)
 
    FLSCL |= BYPASS;                 // Set the one-shot bypass bit
 
-   updateRTCFlags();             // This call will clear the alarm flag
+   sleepEnd = RTC_GetCurrentTime();
+#if POWER_STATS_ENABLE
+   RTC_wakeTime = sleepEnd;
+   RTC_wakePending = 1;
+#endif
+
    restoreRegistersFromSleep();
+
+   // This call will clear the alarm flag. The alarm restarts the RTC count
+   // from zero so the time before it has to be added back.
+   if(updateRTCFlags())
+   {
+      sleepEnd += alarm - sleepStart;
+   }
+   else
+   {
+      sleepEnd -= sleepStart;
+   }
+
+   if(alarm != RTC_alarmPeriod)
+   {
+      RTC_writeAlarm(RTC_alarmPeriod);
+   }
+
+#if POWER_STATS_ENABLE
+   Power_Account(POWER_SLEEP, RTC_countsToMicros(sleepEnd));
+#endif
+   Tick_Resume(RTC_countsToMs(sleepEnd));
+}
+
+//-----------------------------------------------------------------------------
+// RTC_countsToMs
+//-----------------------------------------------------------------------------
+//
+// Convert a number of RTC counts to milliseconds. The remainder is carried
+// over to the next call so repeated sleeps don't lose time.
+//
+uint16_t RTC_countsToMs(uint32_t counts)
+{
+   counts = (counts * 1000L) + RTC_countsResidue;
+   RTC_countsResidue = counts % RTCCLK;
+
+   return counts / RTCCLK;
 }
 
+//-----------------------------------------------------------------------------
+// RTC_countsToMicros
+//-----------------------------------------------------------------------------
+//
+// Convert a number of RTC counts to microseconds. Whole seconds are split
+// off so the products fit in 32 bits.
+//
+uint32_t RTC_countsToMicros(uint32_t counts)
+{
+   return ((counts / RTCCLK) * 1000000L)
+          + (((counts % RTCCLK) * 15625L) / (RTCCLK / 64));
+}
+
+//-----------------------------------------------------------------------------
+// lowPowerScanBegin
+//-----------------------------------------------------------------------------
+//
+// Called before the first sensor of a scan.  Time stamps the scan with both
+// the RTC and Timer 3 for lowPowerScanEnd().
+//
+void lowPowerScanBegin(void)
+{
+   RTC_scanStartMicros = Tick_GetMicros();
+   RTC_scanStart = RTC_GetCurrentTime();
+}
+
+//-----------------------------------------------------------------------------
+// lowPowerScanEnd
+//-----------------------------------------------------------------------------
+//
+// Called after the last sensor of a scan.  Timer 3 stops while the core is
+// suspended for a conversion and the RTC doesn't, so the RTC gives the wall
+// clock time of the scan and the difference between the two is the suspend
+// time.  The suspend time is added back to the 1ms tick.  Reports the scan
+// to the frame module and books the active time of the frame.
+//
+void lowPowerScanEnd(void)
+{
+   uint32_t counts = RTC_GetCurrentTime();
+   uint32_t micros = Tick_GetMicros() - RTC_scanStartMicros;
+
+   // The alarm restarted the count during the scan
+   if(counts < RTC_scanStart)
+   {
+      counts += RTC_alarmPeriod;
+   }
+
+   counts = RTC_countsToMicros(counts - RTC_scanStart);
+   if(counts < micros)
+   {
+      counts = micros;
+   }
+
+   Tick_AddSuspend((counts - micros > 0xFFFF) ? 0xFFFF : (uint16_t)(counts - micros));
+   Frame_ScanDone(RTC_scanStartMicros, (counts > 0xFFFF) ? 0xFFFF : (uint16_t)counts);
+
+#if POWER_STATS_ENABLE
+   Power_Account(POWER_SUSPEND, counts - micros);
+   Power_Update();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// lowPowerMarkScan
+//-----------------------------------------------------------------------------
+//
+// Called before each conversion when POWER_STATS_ENABLE is set. The first
+// one after a wake up records the time since the RTC was read on wake up
+// in wakeLatency.
+//
+#if POWER_STATS_ENABLE
+void lowPowerMarkScan(void)
+{
+   uint32_t counts;
+
+   if(!RTC_wakePending)
+   {
+      return;
+   }
+
+   RTC_wakePending = 0;
+   counts = RTC_GetCurrentTime();
+
+   // The alarm restarted the count in between, nothing to measure
+   if(counts < RTC_wakeTime)
+   {
+      return;
+   }
+
+   // Limit to 2000 counts so the conversion fits in 32 bits
+   counts -= RTC_wakeTime;
+   if(counts > 2000)
+   {
+      counts = 2000;
+   }
+
+   wakeLatency = (counts * 1000000L) / RTCCLK;
+   if(wakeLatency > wakeLatencyWorst)
+   {
+      wakeLatencyWorst = wakeLatency;
+   }
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // Implementation-dependent functions called by LowPowerRoutines.c
 //-----------------------------------------------------------------------------
@@ -250,6 +481,7 @@ void configureRTCSleepMode(void)
    RTC_init ();                        // Initialize SmaRTClock
 
    RTC_setAlarmPeriod(CSLIB_sleepModePeriod); // Set the Alarm Frequency to 25 Hz
+   RTC_activeMode = 0;
    RTC0CN_setBits(RTC0TR+RTC0AEN+ALRM);// Enable Counter, Alarm, and Auto-Reset
 }
 
@@ -266,6 +498,7 @@ void configureRTCActiveMode(void)
    RTC_init ();                        // Initialize SmaRTClock
 
    RTC_setAlarmPeriod(CSLIB_activeModePeriod); // Set the Alarm Frequency to 25 Hz
+   RTC_activeMode = 1;
    RTC0CN_setBits(RTC0TR+RTC0AEN+ALRM);// Enable Counter, Alarm, and Auto-Reset
 
 }
@@ -302,7 +535,7 @@ uint8_t updateRTCFlags(void)
    if(PMU0CFstate & RSTWK)
    {
       // Delay greater than 15uS per datasheet recommendation
-      b = 255;
+      b = RESET_WAKE_DELAY >> Clock_Shift;
       while(b > 0) b--;
    }
 
@@ -675,7 +908,9 @@ void RTC_setAlarmPeriod(uint16_t alarm_frequency)
 {
 
    RTC_zeroCurrentTime();              // Reset the RTC Timer
-   RTC_writeAlarm((RTCCLK * (uint32_t)alarm_frequency) / 1000L);
+   RTC_alarmMs = alarm_frequency;
+   RTC_alarmPeriod = (RTCCLK * (uint32_t)alarm_frequency) / 1000L;
+   RTC_writeAlarm(RTC_alarmPeriod);
 
 }
 
@@ -17,5 +17,14 @@ void enterLowPowerState(void);
 void checkTimer(void);
 extern xdata uint8_t timerTick;
 
+// Wake up to first scan latency, see lowPowerMarkScan()
+void lowPowerMarkScan(void);
+extern xdata uint16_t wakeLatency;
+extern xdata uint16_t wakeLatencyWorst;
+
+// Scan time stamps and power state residency, see lowPowerScanEnd()
+void lowPowerScanBegin(void);
+void lowPowerScanEnd(void);
+
 
 #endif
\ No newline at end of file
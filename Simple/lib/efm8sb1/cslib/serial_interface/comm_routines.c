@@ -6,6 +6,7 @@
 
 #include <si_toolchain.h>
 #include "comm_routines.h"
+#include "tick.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,14 +26,117 @@ idata uint16_t bufferU16[10];
 volatile uint16_t printBase;
 volatile uint16_t printSize;
 volatile uint16_t printCount;
+volatile uint16_t printMask = 0xFFFF;    // Channels printed, bit per index
+
+// Bytes sent since the count was last cleared, see commPutByte()
+uint16_t commByteCount = 0;
+
+// Frames dropped by the COMM_TX_POLICY
+uint16_t commDroppedFrames = 0;
+
+#if COMM_TX_RING
+// The ISR sends from txTail up to txHead.  commPutByte() writes from txHead
+// on at txWrite and commFrameEnd() hands the frame over by moving txHead.
+// The indexes run freely and are masked when the buffer is accessed.
+xdata uint8_t txBuffer[COMM_TX_BUFFER_SIZE];
+volatile uint8_t txHead = 0;
+volatile uint8_t txTail = 0;
+uint8_t txWrite = 0;
+
+// Set by the ISR when it runs out of bytes, the next frame restarts it
+volatile uint8_t txIdle = 1;
+
+// Set when the frame being written didn't fit
+uint8_t txOverflow = 0;
+
+#if COMM_TX_POLICY == COMM_TX_DROP_OLDEST
+// End index of each queued frame, oldest first
+xdata uint8_t txFrameEnd[COMM_TX_FRAMES];
+uint8_t txFrameFirst = 0;
+uint8_t txFrameCount = 0;
+#endif
+
+#if COMM_URGENT_SIZE
+// Urgent records.  Between commUrgentBegin() and commUrgentEnd() the bytes
+// go to urgentBuffer at urgentWrite, and the ISR sends them from urgentTail
+// up to urgentHead as soon as the ring is between two records.
+xdata uint8_t urgentBuffer[COMM_URGENT_SIZE];
+volatile uint8_t urgentHead = 0;
+volatile uint8_t urgentTail = 0;
+uint8_t urgentWrite = 0;
+uint8_t urgentSelect = 0;
+uint8_t urgentOverflow = 0;
+
+// Set while the last byte the ISR sent from the ring ended a record
+volatile uint8_t txBoundary = 1;
+
+// Set by commUrgentEnd() for a record with no other urgent one ahead of it
+// and cleared by the ISR as it starts sending it.  Meanwhile the ISR counts
+// the ring bytes it sends first in commUrgentWait.
+volatile uint8_t commUrgentWaiting = 0;
+volatile uint8_t commUrgentWait = 0;
+
+// Urgent records that didn't fit in urgentBuffer
+uint16_t commUrgentDropped = 0;
+#endif
+#else
+// Set by the ISR once the last byte has gone, commPutByte() waits for it
+volatile uint8_t txReady = 1;
+#endif
+
+// The ISR writes received bytes at rxHead, commGetByte() reads them from
+// rxTail.  The indexes run freely like the transmit ones.
+xdata uint8_t rxBuffer[COMM_RX_BUFFER_SIZE];
+volatile uint8_t rxHead = 0;
+uint8_t rxTail = 0;
+
+// Bytes lost because rxBuffer was full
+uint16_t commRxOverflows = 0;
+
+// Timer1 reload for UART_BAUDRATE at the current SYSCLK.  Timer1 counts
+// SYSCLK and overflows twice a bit, the count is rounded to the nearest.
+#define UART_RELOAD            (-((((UART_SYSCLK >> Clock_Shift) / UART_BAUDRATE) + 1) / 2))
+
+#if (UART_SYSCLK/UART_BAUDRATE/2/256 >= 1)
+#error "UART_BAUDRATE is too low for Timer1 to count SYSCLK"
+#endif
+
+// Powers of ten the formatter subtracts, largest first
+code uint16_t powersOfTen[4] = {10000, 1000, 100, 10};
+
+// Value output of the printOutput functions, each value is followed by a
+// space
+#if COMM_FAST_FORMAT
+#define PRINT_U16(value)       commPutU16(value)
+#define PRINT_S8(value)        commPutS8(value)
+#define PRINT_FLAG(set)        putDigits((set) ? 1 : 0, 3)
+#else
+#define PRINT_U16(value)       printf("%u ", (uint16_t)(value))
+#define PRINT_S8(value)        printf("%bd ", (uint8_t)(value))
+#define PRINT_FLAG(set)        printf((set) ? "1 " : "0 ")
+#endif
+
+#if COMM_FORMAT_BENCHMARK
+// Values formatted each way by commFormatBenchmark(), 257 apart so the
+// 16-bit ones run from 0 to 65535
+#define BENCH_VALUES           256
+#define BENCH_STEP             257
+
+// Set while commFormatBenchmark() runs, commPutByte() then only folds the
+// bytes into benchSum
+uint8_t benchMute = 0;
+uint16_t benchSum;
+#endif
 
 //-----------------------------------------------------------------------------
 // Local function prototypes
 //-----------------------------------------------------------------------------
 
 void UART0_init(void);
-char getChar (void);
-uint16_t getU8(void);
+void putDigits(uint16_t value, uint8_t index);
+#if COMM_TX_POLICY == COMM_TX_DROP_OLDEST
+uint8_t dropOldestFrame(void);
+#endif
 /*
 //-----------------------------------------------------------------------------
 // OutputU8
@@ -97,64 +201,413 @@ uint8_t OutputString(uint8_t* buffer)
 
 */
 //-----------------------------------------------------------------------------
-// getChar
+// commPutByte
 //-----------------------------------------------------------------------------
 //
-// Low-level getChar replacement routine.  Reads one byte from UART and
-// returns that byte.
+// Sends one byte as it is and counts it in commByteCount.  With COMM_TX_RING
+// the byte is only queued, it goes out once commFrameEnd() is called.
 //
-char getChar (void)
+void commPutByte(uint8_t value)
 {
-  char c;  
+#if COMM_FORMAT_BENCHMARK
+   if(benchMute)
+   {
+      benchSum = ((benchSum << 1) | (benchSum >> 15)) ^ value;
+      commByteCount++;
+      return;
+   }
+#endif
+
+#if COMM_TX_RING
+#if COMM_URGENT_SIZE
+   if(urgentSelect)
+   {
+      if((uint8_t)(urgentWrite - urgentTail) >= COMM_URGENT_SIZE)
+      {
+         urgentOverflow = 1;
+         return;
+      }
+      urgentBuffer[urgentWrite & COMM_URGENT_MASK] = value;
+      urgentWrite++;
+      return;
+   }
+#endif
+
+   if(txOverflow)
+   {
+      return;
+   }
+
+   while((uint8_t)(txWrite - txTail) >= COMM_TX_BUFFER_SIZE)
+   {
+#if COMM_TX_POLICY == COMM_TX_DROP_OLDEST
+      if(!dropOldestFrame())
+#endif
+      {
+         txOverflow = 1;
+         return;
+      }
+   }
+
+   txBuffer[txWrite & COMM_TX_MASK] = value;
+   txWrite++;
+#else
+   while (!txReady);
+   txReady = 0;
+   SBUF0 = value;
+#endif
+   commByteCount++;
+}
+
+#if COMM_TX_RING
+//-----------------------------------------------------------------------------
+// commReserveByte
+//-----------------------------------------------------------------------------
+//
+// Queues a placeholder byte and returns its index for commPatchByte().
+//
+uint8_t commReserveByte(void)
+{
+   uint8_t index = txWrite;
+
+#if COMM_URGENT_SIZE
+   if(urgentSelect)
+   {
+      index = urgentWrite;
+   }
+#endif
+   commPutByte(0);
+   return index;
+}
+
+//-----------------------------------------------------------------------------
+// commPatchByte
+//-----------------------------------------------------------------------------
+//
+// Overwrites a byte of the frame being written, before commFrameEnd().
+//
+void commPatchByte(uint8_t index, uint8_t value)
+{
+#if COMM_URGENT_SIZE
+   if(urgentSelect)
+   {
+      if(!urgentOverflow)
+      {
+         urgentBuffer[index & COMM_URGENT_MASK] = value;
+      }
+      return;
+   }
+#endif
+   if(!txOverflow)
+   {
+      txBuffer[index & COMM_TX_MASK] = value;
+   }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// commFrameEnd
+//-----------------------------------------------------------------------------
+//
+// Hands the bytes written since the last call over to the UART0 interrupt as
+// one frame.  A frame that didn't fit is dropped whole and counted in
+// commDroppedFrames.
+//
+void commFrameEnd(void)
+{
+#if COMM_TX_RING
+   if(txOverflow)
+   {
+      txWrite = txHead;
+      txOverflow = 0;
+      commDroppedFrames++;
+      return;
+   }
+
+#if COMM_TX_POLICY == COMM_TX_DROP_OLDEST
+   // Forget the frames that are gone, then make room for this one
+   while(txFrameCount && ((uint8_t)(txFrameEnd[txFrameFirst] - txTail - 1)
+                          >= (uint8_t)(txHead - txTail)))
+   {
+      txFrameFirst = (txFrameFirst + 1) % COMM_TX_FRAMES;
+      txFrameCount--;
+   }
+   if(txFrameCount == COMM_TX_FRAMES)
+   {
+      dropOldestFrame();
+   }
+   txFrameEnd[(txFrameFirst + txFrameCount) % COMM_TX_FRAMES] = txWrite;
+   txFrameCount++;
+#endif
 
-  while (!SCON0_RI);
-  SCON0_RI = 0;
-  c = SBUF0;
-  return c;
+   txHead = txWrite;
+
+   if(txIdle)
+   {
+      txIdle = 0;
+      SCON0_TI = 1;                    // Restart the interrupt
+   }
+#endif
 }
 
+#if COMM_URGENT_SIZE
+//-----------------------------------------------------------------------------
+// commUrgentBegin
+//-----------------------------------------------------------------------------
+//
+// Starts an urgent record.  Until commUrgentEnd() the bytes written go to
+// the urgent buffer instead of the frame being written in the ring.
+//
+void commUrgentBegin(void)
+{
+   urgentSelect = 1;
+   urgentWrite = urgentHead;
+   urgentOverflow = 0;
+}
 
 //-----------------------------------------------------------------------------
-// getU16
+// commUrgentEnd
 //-----------------------------------------------------------------------------
 //
-// Routine that reads a 2-byte unsigned integer using the low-level
-// getChar() routine.  This function excepts data in decimal format and
-// expects data to be delimited by space (' ') characters.
+// Hands the urgent record over to the ISR, which sends it once the record
+// it is on has gone, ahead of any other frame queued in the ring.  A record
+// that didn't fit is dropped and counted in commUrgentDropped.  Returns 1
+// when commUrgentWaiting and commUrgentWait time this record.
 //
-uint16_t getU16(void)
+uint8_t commUrgentEnd(void)
 {
-   uint8_t character;
-   uint16_t output = 0;
-   do
+   uint8_t timed = 0;
+
+   urgentSelect = 0;
+   if(urgentOverflow)
+   {
+      commUrgentDropped++;
+      return 0;
+   }
+
+   if((urgentTail == urgentHead) && !commUrgentWaiting)
    {
-      character = getChar();
+      commUrgentWait = 0;
+      commUrgentWaiting = 1;
+      timed = 1;
    }
-   while((character <= '0') || (character >= '9'));
-   
-   do
+
+   urgentHead = urgentWrite;
+
+   if(txIdle)
    {
-      output = output * 10 + character - '0';
-      character = getChar();
-      
+      txIdle = 0;
+      SCON0_TI = 1;                    // Restart the interrupt
    }
-   while((character >= '0') && (character <= '9'));
-   
-   return output;
-   
 
+   return timed;
 }
+#endif
 
-uint16_t getU8(void)
+#if COMM_TX_POLICY == COMM_TX_DROP_OLDEST
+//-----------------------------------------------------------------------------
+// dropOldestFrame
+//-----------------------------------------------------------------------------
+//
+// Drops the oldest queued frame to make room.  Returns 0 when there is
+// nothing left to drop.
+//
+uint8_t dropOldestFrame(void)
 {
-   uint8_t character;
-   uint16_t output = 0;
+   uint8_t end;
+
+   while(txFrameCount)
+   {
+      end = txFrameEnd[txFrameFirst];
+      txFrameFirst = (txFrameFirst + 1) % COMM_TX_FRAMES;
+      txFrameCount--;
 
-   character = getChar();
-   
-   return output;
-   
+      IE_ES0 = 0;
+      // Skip frames the interrupt has already sent
+      if((uint8_t)(end - txTail - 1) < (uint8_t)(txHead - txTail))
+      {
+         txTail = end;
+         IE_ES0 = 1;
+         commDroppedFrames++;
+         return 1;
+      }
+      IE_ES0 = 1;
+   }
 
+   return 0;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// commPutU16
+//-----------------------------------------------------------------------------
+//
+// Sends <value> in decimal followed by a space, the same bytes as
+// printf("%u ").
+//
+void commPutU16(uint16_t value)
+{
+   putDigits(value, 0);
+}
+
+//-----------------------------------------------------------------------------
+// commPutText
+//-----------------------------------------------------------------------------
+//
+// Sends a constant string, with a '\n' sent as "\r\n" like printf().
+//
+void commPutText(char code *text)
+{
+   while(*text)
+   {
+      putchar(*text++);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// commPutS8
+//-----------------------------------------------------------------------------
+//
+// Sends <value> in decimal followed by a space, the same bytes as
+// printf("%bd ").
+//
+void commPutS8(int8_t value)
+{
+   if(value < 0)
+   {
+      commPutByte('-');
+      putDigits((uint8_t)-value, 2);
+   }
+   else
+   {
+      putDigits(value, 2);
+   }
+}
+
+//-----------------------------------------------------------------------------
+// putDigits
+//-----------------------------------------------------------------------------
+//
+// Sends the digits of <value> and a space, starting from powersOfTen[index].
+// Each digit is counted by subtracting its power of ten, at most nine times,
+// so no division is needed.  Leading zeros are skipped, the units digit is
+// always sent.
+//
+void putDigits(uint16_t value, uint8_t index)
+{
+   uint8_t digit;
+   uint8_t leading = 1;
+
+   for(; index < 4; index++)
+   {
+      digit = '0';
+      while(value >= powersOfTen[index])
+      {
+         value -= powersOfTen[index];
+         digit++;
+      }
+
+      if((digit != '0') || !leading)
+      {
+         commPutByte(digit);
+         leading = 0;
+      }
+   }
+
+   commPutByte('0' + (uint8_t)value);
+   commPutByte(' ');
+}
+
+#if COMM_FORMAT_BENCHMARK
+//-----------------------------------------------------------------------------
+// commFormatBenchmark
+//-----------------------------------------------------------------------------
+//
+// Formats the same 16-bit and 8-bit values with printf() and with the fast
+// formatter.  The bytes are not sent, so only the formatting is timed, but
+// both runs are checked to produce the same bytes.  Prints the average
+// cycles per value pair of each at the fast clock and 1 if the bytes match:
+// *BENCH <printf cycles> <fast cycles> <match>
+//
+void commFormatBenchmark(void)
+{
+   uint16_t index, value;
+   uint16_t printfSum, printfCount;
+   uint32_t start, printfMicros, fastMicros;
+   uint8_t match;
+
+   Clock_Request(CLOCK_FAST);
+   benchMute = 1;
+
+   benchSum = 0;
+   commByteCount = 0;
+   start = Tick_GetMicros();
+   for(index = 0, value = 0; index < BENCH_VALUES; index++, value += BENCH_STEP)
+   {
+      printf("%u ", value);
+      printf("%bd ", (uint8_t)index);
+   }
+   printfMicros = Tick_GetMicros() - start;
+   printfSum = benchSum;
+   printfCount = commByteCount;
+
+   benchSum = 0;
+   commByteCount = 0;
+   start = Tick_GetMicros();
+   for(index = 0, value = 0; index < BENCH_VALUES; index++, value += BENCH_STEP)
+   {
+      commPutU16(value);
+      commPutS8((int8_t)index);
+   }
+   fastMicros = Tick_GetMicros() - start;
+   match = (benchSum == printfSum) && (commByteCount == printfCount);
+
+   benchMute = 0;
+   commByteCount = 0;
+
+   printf("*BENCH %lu %lu %bu\n",
+          (printfMicros * (CLOCK_FAST_HZ / 1000000L)) / BENCH_VALUES,
+          (fastMicros * (CLOCK_FAST_HZ / 1000000L)) / BENCH_VALUES,
+          match);
+
+   Clock_Release(CLOCK_FAST);
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// putchar
+//-----------------------------------------------------------------------------
+//
+// Replaces the library putchar() used by printf() so text output is counted
+// as well.  Like the library version a '\n' is sent as "\r\n".
+//
+char putchar(char c)
+{
+   if(c == '\n')
+   {
+      commPutByte('\r');
+   }
+   commPutByte(c);
+   return c;
+}
+
+//-----------------------------------------------------------------------------
+// commGetByte
+//-----------------------------------------------------------------------------
+//
+// Takes the oldest received byte.  Returns 0 straight away when there is
+// none, so a caller never waits on the host.
+//
+uint8_t commGetByte(uint8_t *value)
+{
+   if(rxTail == rxHead)
+   {
+      return 0;
+   }
+
+   *value = rxBuffer[rxTail & COMM_RX_MASK];
+   rxTail++;
+   return 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -173,6 +626,7 @@ void CSLIB_commInit(void)
    XBR0    = 0x01;                     // Enable UART on P0.4(TX) and P0.5(RX)
    XBR2    = 0x40;                     // Enable crossbar and weak pull-ups
 
+   IE_ES0 = 1;                         // Enable the UART0 interrupt
 
 
 }
@@ -184,7 +638,8 @@ void CSLIB_commInit(void)
 // Return Value : None
 // Parameters   : None
 //
-// Configure the UART0 using Timer1, for <BAUDRATE> and 8-N-1.
+// Configure the UART0 using Timer1, for <BAUDRATE> and 8-N-1.  Timer1
+// counts SYSCLK, see UART_RELOAD.
 //-----------------------------------------------------------------------------
 
 void UART0_init ()
@@ -194,22 +649,9 @@ void UART0_init ()
                                        //        RX enabled
                                        //        ninth bits are zeros
                                        //        clear RI0 and TI0 bits
-   #if (UART_SYSCLK/UART_BAUDRATE/2/256 < 1)
-      TH1 = -(UART_SYSCLK/UART_BAUDRATE/2);
-      CKCON0 &= ~0x0B;                  // T1M = 1; SCA1:0 = xx
-      CKCON0 |=  0x08;
-   #elif (UART_SYSCLK/UART_BAUDRATE/2/256 < 4)
-      TH1 = -(UART_SYSCLK/UART_BAUDRATE/2/4);
-      CKCON &= ~0x0B;                  // T1M = 0; SCA1:0 = 01
-      CKCON |=  0x01;
-   #elif (UART_SYSCLK/UART_BAUDRATE/2/256 < 12)
-      TH1 = -(UART_SYSCLK/UART_BAUDRATE/2/12);
-      CKCON &= ~0x0B;                  // T1M = 0; SCA1:0 = 00
-   #else
-      TH1 = -(UART_SYSCLK/UART_BAUDRATE/2/48);
-      CKCON &= ~0x0B;                  // T1M = 0; SCA1:0 = 10
-      CKCON |=  0x02;
-   #endif
+   TH1 = UART_RELOAD;
+   CKCON0 &= ~0x0B;                    // T1M = 1; SCA1:0 = xx
+   CKCON0 |=  0x08;
 
    TL1 = TH1;                          // Init Timer1
    TMOD &= ~0xf0;                      // TMOD: timer 1 in 8-bit autoreload
@@ -219,6 +661,116 @@ void UART0_init ()
 
 }
 
+//-----------------------------------------------------------------------------
+// UART0_updateBaud
+//-----------------------------------------------------------------------------
+//
+// Return Value : None
+// Parameters   : None
+//
+// Reload Timer1 for <BAUDRATE> after the clock governor changed SYSCLK,
+// with the same UART_RELOAD as UART0_init.
+//-----------------------------------------------------------------------------
+
+void UART0_updateBaud(void)
+{
+   TH1 = UART_RELOAD;
+}
+
+
+//-----------------------------------------------------------------------------
+// printPowerStats
+//-----------------------------------------------------------------------------
+//
+// Outputs one line with the per-mille share of the active, idle, suspend and
+// sleep states, the average current in uA and the battery life in hours,
+// capped at 65535:
+// *POWER <active> <idle> <suspend> <sleep> <uA> <hours>
+//
+#if POWER_STATS_ENABLE
+void printPowerStats(void)
+{
+   uint8_t state;
+   uint32_t hours = Power_GetBatteryHours();
+
+   commPutText("*POWER ");
+   for(state = 0; state < POWER_STATE_COUNT; state++)
+   {
+      commPutU16(Power_GetShare(state));
+   }
+   commPutU16(Power_GetAverageCurrent());
+   commPutU16((hours > 0xFFFF) ? 0xFFFF : (uint16_t)hours);
+   putchar('\n');
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// UART0_ISR
+//-----------------------------------------------------------------------------
+//
+// Queues a received byte in rxBuffer.  Sends the next queued byte with
+// COMM_TX_RING, otherwise tells commPutByte() the last one has gone.  An
+// urgent record goes before the ring bytes once the record being sent from
+// the ring is complete.
+//
+SI_INTERRUPT(UART0_ISR, UART0_IRQn)
+{
+#if COMM_URGENT_SIZE
+   uint8_t value;
+#endif
+
+   if(SCON0_RI)
+   {
+      SCON0_RI = 0;
+      if((uint8_t)(rxHead - rxTail) < COMM_RX_BUFFER_SIZE)
+      {
+         rxBuffer[rxHead & COMM_RX_MASK] = SBUF0;
+         rxHead++;
+      }
+      else
+      {
+         commRxOverflows++;
+      }
+   }
+
+   if(SCON0_TI)
+   {
+      SCON0_TI = 0;
+#if COMM_TX_RING
+#if COMM_URGENT_SIZE
+      if((urgentTail != urgentHead) && txBoundary)
+      {
+         commUrgentWaiting = 0;
+         SBUF0 = urgentBuffer[urgentTail & COMM_URGENT_MASK];
+         urgentTail++;
+      }
+      else if(txTail != txHead)
+      {
+         value = txBuffer[txTail & COMM_TX_MASK];
+         SBUF0 = value;
+         txTail++;
+         txBoundary = (value == 0);
+         if(commUrgentWaiting)
+         {
+            commUrgentWait++;
+         }
+      }
+#else
+      if(txTail != txHead)
+      {
+         SBUF0 = txBuffer[txTail & COMM_TX_MASK];
+         txTail++;
+      }
+#endif
+      else
+      {
+         txIdle = 1;
+      }
+#else
+      txReady = 1;
+#endif
+   }
+}
 
 void outputHeaderCount(HeaderStruct_t headerEntry)
 {
@@ -226,7 +778,8 @@ void outputHeaderCount(HeaderStruct_t headerEntry)
    if(headerEntry.instances > 1)
       for(index = 0; index < headerEntry.instances; index++)
       {
-         printf("%s_%bd ", headerEntry.header,index);
+         if(printMask & (1 << index))
+            printf("%s_%bd ", headerEntry.header,index);
       }
    else
       printf("%s ", headerEntry.header);
@@ -259,13 +812,13 @@ void printOutputSingAct(uint16_t offset, uint8_t bytes)
 	   {
 
 	         output = *ptr;
-	         if(output & 0x40)
+	         if(!(printMask & (1 << index)))
 	         {
-	        	 printf("1 ");
+	            // Channel not selected
 	         }
 	         else
 	         {
-	        	 printf("0 ");
+	        	 PRINT_FLAG(output & 0x40);
 	         }
 	         ptr = ptr + printSize;
 	   }
@@ -284,13 +837,13 @@ void printOutputDebAct(uint16_t offset, uint8_t bytes)
 	   {
 
 	         output = *ptr;
-	         if(output & 0x80)
+	         if(!(printMask & (1 << index)))
 	         {
-	        	 printf("1 ");
+	            // Channel not selected
 	         }
 	         else
 	         {
-	        	 printf("0 ");
+	        	 PRINT_FLAG(output & 0x80);
 	         }
 	         ptr = ptr + printSize;
 	   }
@@ -307,7 +860,8 @@ void printOutputTDelta(uint16_t offset, uint8_t bytes)
 	   for(index = 0; index < printCount; index++)
 	   {
 
-	      printf("%u ", *(uint16_t*)ptr * 4);
+	      if(printMask & (1 << index))
+	         PRINT_U16(*(uint16_t*)ptr * 4);
 
 	      ptr = ptr + printSize;
 	   }
@@ -322,12 +876,16 @@ void printOutput(uint16_t offset, uint8_t bytes)
 
    for(index = 0; index < printCount; index++)
    {
-      if(bytes == 2)
+      if(!(printMask & (1 << index)))
+      {
+         // Channel not selected
+      }
+      else if(bytes == 2)
       {
-         printf("%u ", *(uint16_t*)ptr);
+         PRINT_U16(*(uint16_t*)ptr);
       }
       else if(bytes == 1)
-         printf("%bd ", *ptr);
+         PRINT_S8(*ptr);
 
       ptr = ptr + printSize;
    }
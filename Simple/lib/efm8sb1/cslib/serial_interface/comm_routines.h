@@ -8,6 +8,9 @@
 #define _COMMROUTINES_H
 
 #include <si_toolchain.h>
+#include "clock.h"
+#include "power.h"
+#include "profiler_interface.h"
 
 
 typedef struct{
@@ -19,11 +22,23 @@ uint8_t OutputU8(uint8_t* buffer, uint8_t lengthh, uint8_t transmitconfig);
 uint8_t OutputU16(uint8_t* buffer, uint8_t length, uint8_t transmitconfig);
 uint8_t OutputString(uint8_t* buffer);
 void CSLIB_commInit(void);
-uint16_t getU16(void);
+uint8_t commGetByte(uint8_t *value);
 void outputHeaderCount(HeaderStruct_t);
 void outputBreak(void);
 void outputBeginHeader(void);
 void outputNewLine(void);
+void UART0_updateBaud(void);
+void printPowerStats(void);
+void commPutByte(uint8_t value);
+void commFrameEnd(void);
+uint8_t commReserveByte(void);
+void commPatchByte(uint8_t index, uint8_t value);
+void commPutU16(uint16_t value);
+void commPutS8(int8_t value);
+void commPutText(char code *text);
+void commFormatBenchmark(void);
+void commUrgentBegin(void);
+uint8_t commUrgentEnd(void);
 
 void printOutputSingAct(uint16_t offset, uint8_t bytes);
 void printOutputDebAct(uint16_t offset, uint8_t bytes);
@@ -36,12 +51,61 @@ void printOutput(uint16_t, uint8_t);
 extern uint16_t printBase;
 extern uint16_t printSize;
 extern uint16_t printCount;
+extern uint16_t printMask;
+extern uint16_t commByteCount;
+extern uint16_t commDroppedFrames;
+extern uint16_t commRxOverflows;
+extern uint16_t commUrgentDropped;
+extern volatile uint8_t commUrgentWaiting;
+extern volatile uint8_t commUrgentWait;
 
 // Implementation-specific information
-#define UART_BAUDRATE    (921600L)           // Baud rate of UART in bps
-//#define UART_BAUDRATE    (230400L)           // Baud rate of UART in bps
-#define UART_SYSCLK      24500000L           // SYSCLK frequency in Hz
+// The UART keeps running across clock changes, so the baud rate has to be
+// within 2% at both clock levels.  230400 is 0.9% fast at 20 MHz and 1.4%
+// slow at 5 MHz, 921600 is 1.4% off at 20 MHz but 10% off at 5 MHz.
+//#define UART_BAUDRATE    (921600L)           // Baud rate of UART in bps
+#define UART_BAUDRATE    (230400L)           // Baud rate of UART in bps
+#define UART_SYSCLK      CLOCK_FAST_HZ       // SYSCLK frequency in Hz at the fast clock
 #define INCLUDE_SPACES 1
 
+// Transmit ring buffer drained by the UART0 interrupt.  A text line is about
+// 430 bytes and doesn't fit, so text output keeps the blocking putchar().
+// Only the binary output leaves the scan timing alone whether a host is
+// listening or not.  Text output is kept for the Silicon Labs profiler and
+// costs about 19 ms per line at 230400 baud; spooling it through a ring
+// would take more XRAM than the part has left.
+#define COMM_TX_RING           PROFILER_BINARY
+#define COMM_TX_BUFFER_SIZE    128      // Power of two, 128 at most
+#define COMM_TX_MASK           (COMM_TX_BUFFER_SIZE - 1)
+
+// What happens to a frame that doesn't fit in the ring buffer
+#define COMM_TX_DROP_NEWEST    0        // The new frame is dropped
+#define COMM_TX_DROP_OLDEST    1        // Queued frames make room, the one
+                                        // being sent is cut short
+#define COMM_TX_POLICY         COMM_TX_DROP_NEWEST
+#define COMM_TX_FRAMES         4        // Queued frames COMM_TX_DROP_OLDEST
+                                        // keeps track of
+
+// Urgent records jump ahead of the frames queued in the ring, see
+// commUrgentBegin().  Only the event output needs them.
+#if PROFILER_EVENTS
+#define COMM_URGENT_SIZE       32       // Power of two, 128 at most
+#else
+#define COMM_URGENT_SIZE       0
+#endif
+#define COMM_URGENT_MASK       (COMM_URGENT_SIZE - 1)
+
+// Set to 1 to print the text output values with commPutU16() and
+// commPutS8() instead of printf(), the bytes sent are the same
+#define COMM_FAST_FORMAT       1
+
+// Set to 1 to time the fast formatter against printf() before the header,
+// see commFormatBenchmark()
+#define COMM_FORMAT_BENCHMARK  0
+
+// Receive ring buffer filled by the UART0 interrupt
+#define COMM_RX_BUFFER_SIZE    16       // Power of two, 128 at most
+#define COMM_RX_MASK           (COMM_RX_BUFFER_SIZE - 1)
+
 
 #endif
@@ -0,0 +1,476 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#include "cslib_config.h"
+#include "cslib.h"
+#include "comm_routines.h"
+#include "profiler_interface.h"
+#include "profiler_binary.h"
+#include "command_interface.h"
+#include "event_output.h"
+#include "led_pwm.h"
+#include "touch_event.h"
+#include "frame.h"
+
+//-----------------------------------------------------------------------------
+// Local variables and macros
+//-----------------------------------------------------------------------------
+
+// Parser states
+#define PARSE_COMMAND            0      // Waiting for a command byte
+#define PARSE_PAYLOAD            1      // Collecting the payload
+
+// Longest payload of a command
+#define PAYLOAD_SIZE             4
+
+typedef struct
+{
+   uint8_t command;
+   uint8_t payload;
+} CommandStruct_t;
+
+#define COMMAND_COUNT            11
+
+code CommandStruct_t commandTable[COMMAND_COUNT] =
+{
+   {COMMAND_SELECT, 4},
+   {COMMAND_DECIMATE, 2},
+   {COMMAND_STREAM, 1},
+   {COMMAND_HEADER, 0},
+   {COMMAND_DIAGNOSTIC, 1},
+   {COMMAND_GET, 2},
+   {COMMAND_SET, 4},
+   {COMMAND_DESCRIBE, 2},
+   {COMMAND_COMMIT, 0},
+   {COMMAND_FREEZE, 1},
+   {COMMAND_DUMP, 0}
+};
+
+uint8_t parseState = PARSE_COMMAND;
+uint8_t parseCommand;
+uint8_t parseExpected;
+uint8_t parseCount;
+uint8_t parseAge;
+uint8_t parsePayload[PAYLOAD_SIZE];
+
+// Unknown commands and commands that timed out
+uint16_t commandErrors = 0;
+
+#if LED_PWM_PROFILE
+// Longest LED PWM interrupt seen by the last DIAGNOSTIC_LED_ISR_LOAD
+uint16_t commandIsrWorst = 0;
+#endif
+
+#if RECORDER_ENABLE
+// Next flight recorder entry to send: 0 for the summary, then the frames
+// oldest first, then the events.  DUMP_IDLE when not dumping.
+#define DUMP_IDLE                0xFF
+
+uint8_t dumpEntry = DUMP_IDLE;
+#endif
+
+//-----------------------------------------------------------------------------
+// Local function prototypes
+//-----------------------------------------------------------------------------
+
+void commandExecute(void);
+void commandReply(uint8_t status, uint16_t value);
+#if RECORDER_ENABLE
+void dumpPoll(void);
+void dumpSummary(uint8_t frames, uint8_t events);
+void dumpFrame(RecorderFrame_t xdata *frame);
+void dumpEvent(RecorderEvent_t xdata *event);
+#endif
+
+//-----------------------------------------------------------------------------
+// commandPoll
+//-----------------------------------------------------------------------------
+//
+// Called once a frame.  Feeds up to COMMAND_RX_BUDGET received bytes to the
+// parser and runs each command as its last byte arrives, so the cost of a
+// frame stays bounded however fast the host sends.  A flight recorder dump
+// goes out COMMAND_DUMP_BUDGET entries at a time after the replies.
+//
+void commandPoll(void)
+{
+   uint8_t budget = COMMAND_RX_BUDGET;
+   uint8_t value, index;
+
+   // A command missing a byte would swallow the next one, drop it instead
+   if((parseState == PARSE_PAYLOAD) && (++parseAge > COMMAND_TIMEOUT_FRAMES))
+   {
+      parseState = PARSE_COMMAND;
+      commandErrors++;
+   }
+
+   while(budget-- && commGetByte(&value))
+   {
+      switch(parseState)
+      {
+         case PARSE_COMMAND:
+            for(index = 0; index < COMMAND_COUNT; index++)
+            {
+               if(commandTable[index].command == value)
+               {
+                  break;
+               }
+            }
+            if(index == COMMAND_COUNT)
+            {
+               commandErrors++;
+               break;
+            }
+
+            parseCommand = value;
+            parseExpected = commandTable[index].payload;
+            parseCount = 0;
+            parseAge = 0;
+            if(parseExpected == 0)
+            {
+               commandExecute();
+            }
+            else
+            {
+               parseState = PARSE_PAYLOAD;
+            }
+            break;
+
+         case PARSE_PAYLOAD:
+            parsePayload[parseCount++] = value;
+            if(parseCount == parseExpected)
+            {
+               parseState = PARSE_COMMAND;
+               commandExecute();
+            }
+            break;
+      }
+   }
+
+#if RECORDER_ENABLE
+   dumpPoll();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// commandExecute
+//-----------------------------------------------------------------------------
+//
+// Runs the command in parseCommand and parsePayload[] and replies to it.
+//
+void commandExecute(void)
+{
+   uint8_t status = COMMAND_OK;
+   uint8_t task;
+   uint16_t value = 0;
+
+   switch(parseCommand)
+   {
+      case COMMAND_SELECT:
+         profilerSelect(parsePayload[0] | (parsePayload[1] << 8),
+                        parsePayload[2] | (parsePayload[3] << 8));
+         break;
+
+      case COMMAND_DECIMATE:
+         if(!profilerDecimate(parsePayload[0], parsePayload[1]))
+         {
+            status = COMMAND_BAD_ID;
+         }
+         break;
+
+      case COMMAND_STREAM:
+         profilerStreaming = parsePayload[0] ? 1 : 0;
+         break;
+
+      case COMMAND_HEADER:
+         profilerRestart();
+         break;
+
+      case COMMAND_DIAGNOSTIC:
+         switch(parsePayload[0])
+         {
+            case DIAGNOSTIC_DROPPED:
+               value = commDroppedFrames;
+               break;
+            case DIAGNOSTIC_RX_OVERFLOWS:
+               value = commRxOverflows;
+               break;
+            case DIAGNOSTIC_COMMAND_ERRORS:
+               value = commandErrors;
+               break;
+            case DIAGNOSTIC_FRAME_BYTES:
+               value = profilerBytes;
+               break;
+            case DIAGNOSTIC_FRAME_MICROS:
+               value = profilerMicros;
+               break;
+#if POWER_STATS_ENABLE
+            case DIAGNOSTIC_CURRENT:
+               value = Power_GetAverageCurrent();
+               break;
+#endif
+#if PROFILER_EVENTS
+            case DIAGNOSTIC_EVENT_LATENCY:
+               value = eventLatencyWorst;
+               break;
+            case DIAGNOSTIC_EVENT_DROPPED:
+               value = commUrgentDropped;
+               break;
+#endif
+            case DIAGNOSTIC_TOUCH_DROPPED:
+               value = TouchEvent_GetDropped();
+               break;
+#if LED_PWM_PROFILE
+            case DIAGNOSTIC_LED_ISR_LOAD:
+               value = LedPwm_GetIsrLoad(&commandIsrWorst);
+               break;
+            case DIAGNOSTIC_LED_ISR_WORST:
+               value = commandIsrWorst;
+               break;
+#endif
+            case DIAGNOSTIC_CLEAR_STATS:
+               Scheduler_ClearLoad();
+               Frame_ClearStats();
+               break;
+            case DIAGNOSTIC_FRAME_WORST:
+               value = Frame_GetWorst();
+               break;
+            case DIAGNOSTIC_FRAME_JITTER:
+               value = Frame_GetJitter();
+               break;
+            case DIAGNOSTIC_FRAME_DUTY:
+               value = Frame_GetDuty();
+               break;
+            case DIAGNOSTIC_FRAME_COUNT:
+               value = Frame_GetCount();
+               break;
+            case DIAGNOSTIC_FRAME_SAVED:
+               value = Frame_GetSaved();
+               break;
+            default:
+               // The per task figures take a range of IDs each
+               task = parsePayload[0] - DIAGNOSTIC_TASK_LOAD;
+               if(task < SCHEDULER_TASK_COUNT)
+               {
+                  value = Scheduler_GetLoad(task);
+               }
+               else if((task = parsePayload[0] - DIAGNOSTIC_TASK_MISSED) < SCHEDULER_TASK_COUNT)
+               {
+                  value = Scheduler_GetMissed(task);
+               }
+               else
+               {
+                  status = COMMAND_BAD_ID;
+               }
+               break;
+         }
+         break;
+
+      case COMMAND_GET:
+         status = Param_Get(parsePayload[0], parsePayload[1], &value);
+         break;
+
+      case COMMAND_SET:
+         value = parsePayload[2] | (parsePayload[3] << 8);
+         status = Param_Set(parsePayload[0], parsePayload[1], value);
+         break;
+
+      case COMMAND_DESCRIBE:
+         status = Param_Describe(parsePayload[0], parsePayload[1], &value);
+         break;
+
+      case COMMAND_COMMIT:
+         Param_Commit();
+         break;
+
+#if RECORDER_ENABLE
+      case COMMAND_FREEZE:
+         if(parsePayload[0])
+         {
+            Recorder_Trigger(RECORDER_TRIGGER_HOST);
+         }
+         else
+         {
+            Recorder_Arm();
+            dumpEntry = DUMP_IDLE;
+         }
+         value = Recorder.trigger;
+         break;
+
+      case COMMAND_DUMP:
+         // Only a frozen recording reads back in one piece
+         Recorder_Trigger(RECORDER_TRIGGER_HOST);
+         dumpEntry = 0;
+         value = Recorder.trigger;
+         break;
+#endif
+
+      default:
+         status = COMMAND_BAD_ID;
+         break;
+   }
+
+   commandReply(status, value);
+}
+
+//-----------------------------------------------------------------------------
+// commandReply
+//-----------------------------------------------------------------------------
+//
+// Sends the reply to parseCommand with the frame being written, as a reply
+// record or as a text line, each value followed by a space:
+// *REPLY <command> <status> <value>
+//
+void commandReply(uint8_t status, uint16_t value)
+{
+#if PROFILER_BINARY
+   binarySendReply(parseCommand, status, value);
+#else
+   commPutText("*REPLY ");
+   commPutByte(parseCommand);
+   commPutByte(' ');
+   commPutU16(status);
+   commPutU16(value);
+   commPutText("\n");
+#endif
+}
+
+#if RECORDER_ENABLE
+
+//-----------------------------------------------------------------------------
+// dumpPoll
+//-----------------------------------------------------------------------------
+//
+// Sends the next COMMAND_DUMP_BUDGET entries of a flight recorder dump.
+//
+void dumpPoll(void)
+{
+   uint8_t budget = COMMAND_DUMP_BUDGET;
+   uint8_t frames = Recorder_GetFrameCount();
+   uint8_t events = Recorder_GetEventCount();
+
+   while(budget-- && (dumpEntry != DUMP_IDLE))
+   {
+      if(dumpEntry == 0)
+      {
+         dumpSummary(frames, events);
+      }
+      else if(dumpEntry <= frames)
+      {
+         dumpFrame(Recorder_GetFrame(dumpEntry - 1));
+      }
+      else
+      {
+         dumpEvent(Recorder_GetEvent(dumpEntry - 1 - frames));
+      }
+
+      if(dumpEntry == frames + events)
+      {
+         dumpEntry = DUMP_IDLE;
+      }
+      else
+      {
+         dumpEntry++;
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// dumpSummary
+//-----------------------------------------------------------------------------
+//
+// Sends what froze the recorder, the number of frames and events that
+// follow and the baselines at the last frame, as a recorder record or as a
+// text line, each value followed by a space:
+// *RECORDER <trigger> <frames> <events> <baseline_0> ...
+//
+void dumpSummary(uint8_t frames, uint8_t events)
+{
+   uint8_t index;
+
+#if PROFILER_BINARY
+   recordBegin(BINARY_RECORD_RECORDER, 5 + (DEF_NUM_SENSORS * 2));
+   recordPut(Recorder.trigger);
+   recordPut(frames);
+   recordPut(events);
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      recordPut(Recorder.baseline[index] & 0xFF);
+      recordPut(Recorder.baseline[index] >> 8);
+   }
+   recordEnd();
+#else
+   commPutText("*RECORDER ");
+   commPutU16(Recorder.trigger);
+   commPutU16(frames);
+   commPutU16(events);
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      commPutU16(Recorder.baseline[index]);
+   }
+   commPutText("\n");
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// dumpFrame
+//-----------------------------------------------------------------------------
+//
+// Sends a recorded frame, as a recorder frame record or as a text line, each
+// value followed by a space:
+// *RECFRAME <scan number> <debounce bits> <delta_0> ...
+//
+void dumpFrame(RecorderFrame_t xdata *frame)
+{
+   uint8_t index;
+
+#if PROFILER_BINARY
+   recordBegin(BINARY_RECORD_RECORDER_FRAME, 5 + DEF_NUM_SENSORS);
+   recordPut(frame->sequence);
+   recordPut(frame->debounce & 0xFF);
+   recordPut(frame->debounce >> 8);
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      recordPut(frame->delta[index]);
+   }
+   recordEnd();
+#else
+   commPutText("*RECFRAME ");
+   commPutU16(frame->sequence);
+   commPutU16(frame->debounce);
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      commPutU16(frame->delta[index]);
+   }
+   commPutText("\n");
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// dumpEvent
+//-----------------------------------------------------------------------------
+//
+// Sends a recorded touch event, as a recorder event record or as a text
+// line, each value followed by a space:
+// *RECEVENT <scan number> <type> <button>
+//
+void dumpEvent(RecorderEvent_t xdata *event)
+{
+#if PROFILER_BINARY
+   recordBegin(BINARY_RECORD_RECORDER_EVENT, 5);
+   recordPut(event->sequence);
+   recordPut(event->type);
+   recordPut(event->source);
+   recordEnd();
+#else
+   commPutText("*RECEVENT ");
+   commPutU16(event->sequence);
+   commPutU16(event->type);
+   commPutU16(event->source);
+   commPutText("\n");
+#endif
+}
+
+#endif
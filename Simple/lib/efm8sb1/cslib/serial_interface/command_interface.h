@@ -0,0 +1,76 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#ifndef _COMMAND_INTERFACE_H
+#define _COMMAND_INTERFACE_H
+
+#include <si_toolchain.h>
+#include "param.h"
+#include "recorder.h"
+#include "scheduler.h"
+
+// Host commands, the command byte is followed by a fixed number of payload
+// bytes.  16-bit values are little-endian.
+#define COMMAND_SELECT           'S'    // <field mask> <channel mask>
+#define COMMAND_DECIMATE         'D'    // <field id> <factor>
+#define COMMAND_STREAM           'O'    // <0 to pause, 1 to resume>
+#define COMMAND_HEADER           'H'    // Send the header again
+#define COMMAND_DIAGNOSTIC       'I'    // <diagnostic id>
+#define COMMAND_GET              'G'    // <parameter id> <channel>
+#define COMMAND_SET              'P'    // <parameter id> <channel> <value>
+#define COMMAND_DESCRIBE         'Q'    // <parameter id> <PARAM_INFO_ item>
+#define COMMAND_COMMIT           'C'    // Save the parameters to flash
+#define COMMAND_FREEZE           'F'    // <1 for a missed touch, 0 to re-arm>
+#define COMMAND_DUMP             'R'    // Send the flight recorder
+
+// Status of a reply, the same as the parameter registry returns
+#define COMMAND_OK               PARAM_OK
+#define COMMAND_BAD_ID           PARAM_BAD_ID
+#define COMMAND_BAD_VALUE        PARAM_BAD_VALUE
+
+// Values the COMMAND_DIAGNOSTIC command returns
+#define DIAGNOSTIC_DROPPED       0      // Frames dropped by the transmit ring
+#define DIAGNOSTIC_RX_OVERFLOWS  1      // Bytes lost by the receive ring
+#define DIAGNOSTIC_COMMAND_ERRORS 2     // Unknown or timed out commands
+#define DIAGNOSTIC_FRAME_BYTES   3      // Bytes of the last frame
+#define DIAGNOSTIC_FRAME_MICROS  4      // Time taken by the last frame
+#define DIAGNOSTIC_CURRENT       5      // Average supply current in uA
+#define DIAGNOSTIC_EVENT_LATENCY 6      // Worst event latency in us
+#define DIAGNOSTIC_EVENT_DROPPED 7      // Event records that didn't fit
+#define DIAGNOSTIC_LED_ISR_LOAD  8      // LED PWM interrupt time in parts per
+                                        // thousand since the previous read
+#define DIAGNOSTIC_LED_ISR_WORST 9      // Longest LED PWM interrupt in us up
+                                        // to the last DIAGNOSTIC_LED_ISR_LOAD
+#define DIAGNOSTIC_TOUCH_DROPPED 10     // Touch events lost to a full queue
+#define DIAGNOSTIC_CLEAR_STATS   11     // Restart the task and frame figures,
+                                        // returns 0
+#define DIAGNOSTIC_FRAME_WORST   12     // Longest frame in us, without sleep
+#define DIAGNOSTIC_FRAME_JITTER  13     // Worst frame start error in us
+#define DIAGNOSTIC_FRAME_DUTY    14     // Time spent in frames in parts per
+                                        // thousand
+#define DIAGNOSTIC_FRAME_COUNT   15     // Frames run
+#define DIAGNOSTIC_FRAME_SAVED   16     // Frames saved over a fixed active
+                                        // rate in parts per thousand
+#define DIAGNOSTIC_TASK_LOAD     32     // + task ID: CPU time of the task in
+                                        // parts per thousand, without sleep
+                                        // and conversion suspend
+#define DIAGNOSTIC_TASK_MISSED   40     // + task ID: late or skipped runs
+
+// Received bytes handled by one commandPoll()
+#define COMMAND_RX_BUDGET        16
+
+// Frames a command may take to arrive before it is dropped
+#define COMMAND_TIMEOUT_FRAMES   5
+
+// Flight recorder entries sent by one commandPoll().  A text line of each
+// fits the transmit ring next to a reply, pause the stream while dumping.
+#define COMMAND_DUMP_BUDGET      1
+
+void commandPoll(void);
+
+extern uint16_t commandErrors;
+
+#endif
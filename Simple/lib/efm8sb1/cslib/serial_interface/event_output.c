@@ -0,0 +1,221 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#include "cslib_config.h"
+#include "cslib.h"
+#include "comm_routines.h"
+#include "profiler_interface.h"
+#include "profiler_binary.h"
+#include "event_output.h"
+#include "tick.h"
+#include "frame.h"
+#include "circle_slider.h"
+#include "touch_event.h"
+
+#if PROFILER_EVENTS
+
+#if !PROFILER_BINARY
+#error "Event records are sent through the transmit ring buffer"
+#endif
+
+//-----------------------------------------------------------------------------
+// Event records
+//-----------------------------------------------------------------------------
+//
+// Each record goes out as an urgent record, see commUrgentBegin(), so it
+// only waits for the rest of the data record already on the wire.  That is
+// at most COMM_TX_BUFFER_SIZE bytes, 5.6 ms at 230400 baud, however many
+// frames are queued.  The framing is that of profiler_binary.c.  All time
+// stamps are microsecond ticks (32 bits).
+//
+// BINARY_RECORD_EVENT    <sensor> <1 touch, 0 release> <time>
+// BINARY_RECORD_WHEEL    <angle, 16 bits> <time>
+// BINARY_RECORD_GESTURE  <source> <gesture> <time>
+//
+// A wheel record is sent when a settled single touch lands on the wheel and
+// then each time it moves EVENT_WHEEL_STEP degrees.  The gesture source is
+// EVENT_SOURCE_WHEEL for a pinch or spread (SLIDER_GESTURE_), or the button
+// number for a hold, repeat or double tap (TOUCH_EVENT_).
+//
+// The latency of the first record sent after a scan is the time from the
+// end of that scan to commUrgentEnd(), plus the ring bytes the UART sent
+// before it, at 10 bits each.
+//
+
+//-----------------------------------------------------------------------------
+// Local variables
+//-----------------------------------------------------------------------------
+
+// Debounced state of the sensors at the last scan, one bit each
+uint16_t eventDebounce = 0;
+
+// Angle of the last wheel record, SLIDER_NO_ANGLE while untouched
+uint16_t eventAngle = SLIDER_NO_ANGLE;
+
+// Set while the first byte of a timed record is on its way, with the time
+// from the scan to the queue
+uint8_t eventTiming = 0;
+uint16_t eventQueueMicros;
+
+uint16_t eventLatency = 0;
+uint16_t eventLatencyWorst = 0;
+
+//-----------------------------------------------------------------------------
+// Local function prototypes
+//-----------------------------------------------------------------------------
+
+void eventFinish(void);
+void eventEnd(uint32_t time);
+
+//-----------------------------------------------------------------------------
+// eventPoll
+//-----------------------------------------------------------------------------
+//
+// Called once a frame after the scan and the wheel update.  Sends a record
+// for each debounce edge and wheel movement of the frame.
+//
+void eventPoll(void)
+{
+   uint8_t index;
+   uint16_t state = 0;
+   uint16_t changed;
+   uint16_t angle, distance;
+   uint32_t time = Frame_GetScanStart() + Frame_GetScanDuration();
+
+   eventFinish();
+
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      if(CSLIB_node[index].activeIndicator & DEBOUNCE_ACTIVE_MASK)
+      {
+         state |= (1 << index);
+      }
+   }
+
+   changed = state ^ eventDebounce;
+   eventDebounce = state;
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      if(changed & (1 << index))
+      {
+         commUrgentBegin();
+         recordBegin(BINARY_RECORD_EVENT, 8);
+         recordPut(index);
+         recordPut((state & (1 << index)) ? 1 : 0);
+         eventEnd(time);
+      }
+   }
+
+   angle = circle_slider_getAngle();
+   if(angle == SLIDER_NO_ANGLE)
+   {
+      eventAngle = SLIDER_NO_ANGLE;
+   }
+   else
+   {
+      // Distance the short way round the wheel
+      distance = (angle > eventAngle) ? angle - eventAngle : eventAngle - angle;
+      if(distance > 180)
+      {
+         distance = 360 - distance;
+      }
+
+      if((eventAngle == SLIDER_NO_ANGLE) || (distance >= EVENT_WHEEL_STEP))
+      {
+         eventAngle = angle;
+         commUrgentBegin();
+         recordBegin(BINARY_RECORD_WHEEL, 8);
+         recordPut(angle & 0xFF);
+         recordPut(angle >> 8);
+         eventEnd(time);
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// eventGesture
+//-----------------------------------------------------------------------------
+//
+// Sends a gesture record for a wheel pinch or spread.  The application
+// collects the gesture from circle_slider_getGesture() and passes it here,
+// time stamped with the end of the scan that saw it.
+//
+void eventGesture(uint8_t gesture)
+{
+   commUrgentBegin();
+   recordBegin(BINARY_RECORD_GESTURE, 8);
+   recordPut(EVENT_SOURCE_WHEEL);
+   recordPut(gesture);
+   eventEnd(Frame_GetScanStart() + Frame_GetScanDuration());
+}
+
+//-----------------------------------------------------------------------------
+// eventButton
+//-----------------------------------------------------------------------------
+//
+// Sends a gesture record for a button hold, repeat or double tap, pass it
+// every touch event.  Presses and releases are already debounce edges.
+//
+void eventButton(uint8_t type, uint8_t button)
+{
+   if((type == TOUCH_EVENT_PRESS) || (type == TOUCH_EVENT_RELEASE))
+   {
+      return;
+   }
+
+   commUrgentBegin();
+   recordBegin(BINARY_RECORD_GESTURE, 8);
+   recordPut(button);
+   recordPut(type);
+   eventEnd(Tick_GetMicros());
+}
+
+//-----------------------------------------------------------------------------
+// eventFinish
+//-----------------------------------------------------------------------------
+//
+// Works out eventLatency once the timed record has started, adding the ring
+// bytes it waited for.
+//
+void eventFinish(void)
+{
+   if(eventTiming && !commUrgentWaiting)
+   {
+      eventTiming = 0;
+      eventLatency = eventQueueMicros
+                     + (uint16_t)((commUrgentWait * 10000000L) / UART_BAUDRATE);
+      if(eventLatency > eventLatencyWorst)
+      {
+         eventLatencyWorst = eventLatency;
+      }
+   }
+}
+
+//-----------------------------------------------------------------------------
+// eventEnd
+//-----------------------------------------------------------------------------
+//
+// Appends the time stamp, closes the record and sends it.  Starts timing it
+// when no other record is ahead of it.
+//
+void eventEnd(uint32_t time)
+{
+   recordPut(time & 0xFF);
+   recordPut((time >> 8) & 0xFF);
+   recordPut((time >> 16) & 0xFF);
+   recordPut(time >> 24);
+   recordEnd();
+
+   eventFinish();
+   if(commUrgentEnd())
+   {
+      time = Tick_GetMicros() - time;
+      eventQueueMicros = (time > 0xFFFF) ? 0xFFFF : (uint16_t)time;
+      eventTiming = 1;
+   }
+}
+
+#endif
@@ -0,0 +1,28 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#ifndef _EVENT_OUTPUT_H
+#define _EVENT_OUTPUT_H
+
+#include <si_toolchain.h>
+#include "profiler_interface.h"
+
+// Change in degrees of a held wheel touch that sends a new wheel record
+#define EVENT_WHEEL_STEP         3
+
+// Gesture record source for the wheel, buttons are 0 up
+#define EVENT_SOURCE_WHEEL       0xFF
+
+void eventPoll(void);
+void eventButton(uint8_t type, uint8_t button);
+void eventGesture(uint8_t gesture);
+
+// Time in microseconds from the end of the scan that saw an event to the
+// first byte of its record on the wire, last and worst seen
+extern uint16_t eventLatency;
+extern uint16_t eventLatencyWorst;
+
+#endif
@@ -0,0 +1,675 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#include "cslib_config.h"
+#include "cslib.h"
+#include "comm_routines.h"
+#include "profiler_interface.h"
+#include "profiler_binary.h"
+#include "frame.h"
+
+#if PROFILER_BINARY
+
+#if !COMM_TX_RING
+#error "Binary records are encoded in the transmit ring buffer"
+#endif
+
+//-----------------------------------------------------------------------------
+// Record format
+//-----------------------------------------------------------------------------
+//
+// <type> <length> <body> <crc16>
+//
+// <length> counts the type, length and body bytes.  The CRC16 (CCITT,
+// polynomial 0x1021, initial value 0xFFFF) covers the same bytes.  All fields
+// are little-endian.  Each record is COBS encoded and ends with a 0x00 byte,
+// so a host can pick up the stream at any point.
+//
+// Field ids are the headerEntries[] indexes of profiler_interface.c.  NOISE
+// is always 0 in this build and is never sent.  The fields and channels sent
+// are picked with the host commands, see command_interface.c.
+//
+// The schema record is sent at start up and after every command.  Its body
+// is the layout version, the number of channels, the channel mask, then the
+// number of fields followed by a <field id> <width> <decimation> entry for
+// each field selected.
+//
+// A data record body is the mask of the field ids it holds, the timing of
+// the scan, then each of these fields in id order.  A channel field has a
+// value for each channel selected, a global field has one value.  The timing
+// is the scan number (16 bits, a gap means scans were not sent), the
+// microsecond tick at the start of the scan (32 bits) and the wall clock
+// duration of the scan in microseconds (16 bits).
+//
+// With PROFILER_DELTA a data record is only sent as a key frame, every
+// PROFILER_KEYFRAME_INTERVAL records, after a dropped frame and after the
+// schema.  It always holds every field selected.  The records in between
+// are delta records, holding only the fields whose decimation is due.
+// Their body is the field mask, then the timing, then a bitmap with one bit
+// per value in data record order, least significant bit first, then the new
+// value of each value whose bit is set.  Each is the difference to the last
+// value sent, zigzag encoded (0, -1, 1, -2 ...) and packed as a varint (7
+// bits per byte, least significant first, bit 7 set on all but the last
+// byte).  The timing is the low byte of the scan number, the scan start as
+// a varint of the time since the scan start of the last record and the
+// duration as a varint.  A host that misses a record or sees a bad CRC waits
+// for the next data record.
+//
+// An event record is sent ahead of the data of the scan that saw a sensor's
+// debounced state change.  Its body is the sensor index, 1 for a touch or 0
+// for a release, and the microsecond tick at the end of that scan (32 bits).
+// With PROFILER_EVENTS the event records, and the wheel and gesture records,
+// come from event_output.c instead.
+//
+// A flight recorder dump, see recorder.c, is a recorder record followed by
+// a recorder frame record for each frame, oldest first, then a recorder
+// event record for each event.  The recorder record body is the trigger,
+// the number of frames and of events, and the baseline of each channel (16
+// bits).  A frame body is the low byte of the scan number, the debounce
+// bits (16 bits) and the touch delta of each channel divided by
+// 2^RECORDER_SHIFT (8 bits).  An event body is the low byte of the scan
+// number, the TOUCH_EVENT_ type and the button.
+//
+// With POWER_STATS_ENABLE a power record is sent every POWER_PRINT_FRAMES
+// frames.  Its body is the share of the active, idle, suspend and sleep
+// states in parts per thousand (16 bits each), the average current in uA
+// (16 bits) and the battery life in hours (32 bits).
+//
+
+// Fields a record can carry, see binaryFields[]
+#define BINARY_FIELDS            10
+#define BINARY_FIELD_IDS         0x077F
+
+// Values the delta references are kept for, 5 channel and 5 global fields
+#define VALUE_COUNT              ((DEF_NUM_SENSORS * 5) + 5)
+
+// binaryFields[] offset of a global field
+#define GLOBAL                   0xFF
+
+// Longest run of non-zero bytes a COBS code byte covers
+#define COBS_MAX_RUN             254
+
+typedef struct
+{
+   uint8_t id;                            // headerEntries[] index
+   uint8_t offset;                        // offsetArray[] entry, or GLOBAL
+   uint8_t width;                         // Bytes, or BINARY_WIDTH_BITMAP
+   uint8_t reference;                     // First deltaReference[] entry
+} BinaryField_t;
+
+code BinaryField_t binaryFields[BINARY_FIELDS] =
+{
+   {0, 0, 2, 0},                                      // BASELINE
+   {1, 1, 2, DEF_NUM_SENSORS},                        // RAW
+   {2, 2, 2, DEF_NUM_SENSORS * 2},                    // PROCESS
+   {3, GLOBAL, BINARY_WIDTH_BITMAP, DEF_NUM_SENSORS * 5},  // SINGACT
+   {4, GLOBAL, BINARY_WIDTH_BITMAP, (DEF_NUM_SENSORS * 5) + 1}, // DEBACT
+   {5, 5, 1, DEF_NUM_SENSORS * 3},                    // TDELTA
+   {6, 7, 2, DEF_NUM_SENSORS * 4},                    // EXPVAL
+   {8, GLOBAL, 2, (DEF_NUM_SENSORS * 5) + 2},         // NOISEEST
+   {9, GLOBAL, 2, (DEF_NUM_SENSORS * 5) + 3},         // ACTTHR
+   {10, GLOBAL, 2, (DEF_NUM_SENSORS * 5) + 4}         // INACTTHR
+};
+
+// CRC16 CCITT for one nibble
+code uint16_t crcNibble[16] =
+{
+   0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+   0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+//-----------------------------------------------------------------------------
+// Local variables
+//-----------------------------------------------------------------------------
+
+// CRC of the record being sent and the COBS code byte of its current run,
+// reserved in the transmit buffer and filled in once the run ends
+uint16_t recordCrc;
+uint8_t cobsCode;
+uint8_t cobsRun;
+
+// Field ids in the record being sent and the value itemNext() is on
+uint16_t recordFields;
+uint8_t itemField;
+uint8_t itemChannel;
+
+#if PROFILER_DELTA
+// Last value sent of each field, the reference of the next delta record
+xdata uint16_t deltaReference[VALUE_COUNT];
+
+// Records left until the next key frame, 0 sends one next
+uint8_t keyframeCountdown = 0;
+
+// commDroppedFrames when the last record was sent
+uint16_t deltaDropped = 0;
+
+// Scan start of the last record sent
+uint32_t timingStart;
+#endif
+
+#if !PROFILER_EVENTS
+// Debounced state of the sensors at the last scan, one bit each
+uint16_t eventDebounce = 0;
+#endif
+
+//-----------------------------------------------------------------------------
+// Local function prototypes
+//-----------------------------------------------------------------------------
+
+void itemFirst(void);
+uint8_t itemNext(void);
+uint16_t itemValue(void);
+void cobsPut(uint8_t value);
+void sendEvents(void);
+#if PROFILER_DELTA
+void sendDelta(void);
+uint8_t varintSize(uint32_t value);
+void varintPut(uint32_t value);
+#endif
+
+//-----------------------------------------------------------------------------
+// binarySendSchema
+//-----------------------------------------------------------------------------
+//
+// Sends the schema record describing the data records that follow.
+//
+void binarySendSchema(void)
+{
+   uint8_t field, count = 0;
+   uint16_t fields = profilerFieldMask & BINARY_FIELD_IDS;
+
+   for(field = 0; field < BINARY_FIELDS; field++)
+   {
+      if(fields & (1 << binaryFields[field].id))
+      {
+         count++;
+      }
+   }
+
+   recordBegin(BINARY_RECORD_SCHEMA, 7 + (count * 3));
+   recordPut(BINARY_SCHEMA_VERSION);
+   recordPut(DEF_NUM_SENSORS);
+   recordPut(profilerChannelMask & 0xFF);
+   recordPut(profilerChannelMask >> 8);
+   recordPut(count);
+   for(field = 0; field < BINARY_FIELDS; field++)
+   {
+      if(fields & (1 << binaryFields[field].id))
+      {
+         recordPut(binaryFields[field].id);
+         recordPut(binaryFields[field].width);
+         recordPut(profilerDecimation[binaryFields[field].id]);
+      }
+   }
+   recordEnd();
+
+#if PROFILER_DELTA
+   keyframeCountdown = 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// binarySendReply
+//-----------------------------------------------------------------------------
+//
+// Sends the reply record to a host command.
+//
+void binarySendReply(uint8_t command, uint8_t status, uint16_t value)
+{
+   recordBegin(BINARY_RECORD_REPLY, 6);
+   recordPut(command);
+   recordPut(status);
+   recordPut(value & 0xFF);
+   recordPut(value >> 8);
+   recordEnd();
+}
+
+#if POWER_STATS_ENABLE
+//-----------------------------------------------------------------------------
+// binarySendPower
+//-----------------------------------------------------------------------------
+//
+// Sends the power statistics record, the binary form of printPowerStats().
+//
+void binarySendPower(void)
+{
+   uint8_t state;
+   uint16_t value;
+   uint32_t hours = Power_GetBatteryHours();
+
+   recordBegin(BINARY_RECORD_POWER, 2 + (POWER_STATE_COUNT * 2) + 6);
+   for(state = 0; state < POWER_STATE_COUNT; state++)
+   {
+      value = Power_GetShare(state);
+      recordPut(value & 0xFF);
+      recordPut(value >> 8);
+   }
+   value = Power_GetAverageCurrent();
+   recordPut(value & 0xFF);
+   recordPut(value >> 8);
+   recordPut(hours & 0xFF);
+   recordPut((hours >> 8) & 0xFF);
+   recordPut((hours >> 16) & 0xFF);
+   recordPut(hours >> 24);
+   recordEnd();
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// binaryCommUpdate
+//-----------------------------------------------------------------------------
+//
+// Sends one data record with the current sensor data, or a delta record
+// with PROFILER_DELTA.
+//
+void binaryCommUpdate(void)
+{
+   uint8_t length = 12;
+   uint16_t value;
+   uint32_t start = Frame_GetScanStart();
+
+#if !PROFILER_EVENTS
+   sendEvents();
+#endif
+
+#if PROFILER_DELTA
+   if((keyframeCountdown != 0) && (deltaDropped == commDroppedFrames))
+   {
+      keyframeCountdown--;
+      sendDelta();
+      return;
+   }
+
+   keyframeCountdown = PROFILER_KEYFRAME_INTERVAL - 1;
+   deltaDropped = commDroppedFrames;
+#endif
+
+   recordFields = profilerFieldMask & BINARY_FIELD_IDS;
+
+   itemFirst();
+   while(itemNext())
+   {
+      length += (binaryFields[itemField].width == 1) ? 1 : 2;
+   }
+
+   recordBegin(BINARY_RECORD_DATA, length);
+   recordPut(recordFields & 0xFF);
+   recordPut(recordFields >> 8);
+   value = Frame_GetSequence();
+   recordPut(value & 0xFF);
+   recordPut(value >> 8);
+   recordPut(start & 0xFF);
+   recordPut((start >> 8) & 0xFF);
+   recordPut((start >> 16) & 0xFF);
+   recordPut(start >> 24);
+   value = Frame_GetScanDuration();
+   recordPut(value & 0xFF);
+   recordPut(value >> 8);
+#if PROFILER_DELTA
+   timingStart = start;
+#endif
+
+   itemFirst();
+   while(itemNext())
+   {
+      value = itemValue();
+#if PROFILER_DELTA
+      deltaReference[binaryFields[itemField].reference
+                     + ((binaryFields[itemField].offset == GLOBAL) ? 0 : itemChannel)] = value;
+#endif
+      recordPut(value & 0xFF);
+      if(binaryFields[itemField].width != 1)
+      {
+         recordPut(value >> 8);
+      }
+   }
+   recordEnd();
+}
+
+#if PROFILER_DELTA
+//-----------------------------------------------------------------------------
+// sendDelta
+//-----------------------------------------------------------------------------
+//
+// Sends a delta record against deltaReference[].  The length has to be known
+// before the body, so the varint sizes are worked out first.
+//
+void sendDelta(void)
+{
+   uint8_t position, bitmap, reference;
+   uint8_t length = 5;
+   uint16_t value;
+   uint32_t start = Frame_GetScanStart() - timingStart;
+
+   recordFields = profilerFieldMask & profilerDueMask & BINARY_FIELD_IDS;
+   if(!recordFields)
+   {
+      return;
+   }
+
+   position = 0;
+   itemFirst();
+   while(itemNext())
+   {
+      reference = binaryFields[itemField].reference
+                  + ((binaryFields[itemField].offset == GLOBAL) ? 0 : itemChannel);
+      value = itemValue() - deltaReference[reference];
+      value = (value << 1) ^ (((int16_t)value < 0) ? 0xFFFF : 0x0000);
+      if(value != 0)
+      {
+         length += (value < 0x80) ? 1 : ((value < 0x4000) ? 2 : 3);
+      }
+      position++;
+   }
+   length += (position + 7) / 8;
+   length += varintSize(start) + varintSize(Frame_GetScanDuration());
+
+   recordBegin(BINARY_RECORD_DELTA, length);
+   recordPut(recordFields & 0xFF);
+   recordPut(recordFields >> 8);
+   recordPut(Frame_GetSequence() & 0xFF);
+   varintPut(start);
+   varintPut(Frame_GetScanDuration());
+   timingStart += start;
+
+   position = 0;
+   bitmap = 0;
+   itemFirst();
+   while(itemNext())
+   {
+      reference = binaryFields[itemField].reference
+                  + ((binaryFields[itemField].offset == GLOBAL) ? 0 : itemChannel);
+      if(itemValue() != deltaReference[reference])
+      {
+         bitmap |= 1 << position;
+      }
+      if(++position == 8)
+      {
+         recordPut(bitmap);
+         bitmap = 0;
+         position = 0;
+      }
+   }
+   if(position)
+   {
+      recordPut(bitmap);
+   }
+
+   itemFirst();
+   while(itemNext())
+   {
+      reference = binaryFields[itemField].reference
+                  + ((binaryFields[itemField].offset == GLOBAL) ? 0 : itemChannel);
+      value = itemValue() - deltaReference[reference];
+      if(value == 0)
+      {
+         continue;
+      }
+
+      deltaReference[reference] += value;
+      value = (value << 1) ^ (((int16_t)value < 0) ? 0xFFFF : 0x0000);
+      while(value >= 0x80)
+      {
+         recordPut((value & 0x7F) | 0x80);
+         value >>= 7;
+      }
+      recordPut(value);
+   }
+
+   recordEnd();
+}
+
+//-----------------------------------------------------------------------------
+// varintSize, varintPut
+//-----------------------------------------------------------------------------
+//
+// Size of and send an unsigned value packed as a varint, for the timing of
+// the delta records.
+//
+uint8_t varintSize(uint32_t value)
+{
+   uint8_t size = 1;
+
+   while(value >= 0x80)
+   {
+      value >>= 7;
+      size++;
+   }
+
+   return size;
+}
+
+void varintPut(uint32_t value)
+{
+   while(value >= 0x80)
+   {
+      recordPut((value & 0x7F) | 0x80);
+      value >>= 7;
+   }
+   recordPut(value);
+}
+#endif
+
+#if !PROFILER_EVENTS
+//-----------------------------------------------------------------------------
+// sendEvents
+//-----------------------------------------------------------------------------
+//
+// Sends an event record for each sensor whose debounced state changed in
+// the last scan, time stamped with the end of that scan.
+//
+void sendEvents(void)
+{
+   uint8_t index;
+   uint16_t state = 0;
+   uint16_t changed;
+   uint32_t time;
+
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      if(CSLIB_node[index].activeIndicator & DEBOUNCE_ACTIVE_MASK)
+      {
+         state |= (1 << index);
+      }
+   }
+
+   changed = state ^ eventDebounce;
+   eventDebounce = state;
+   if(!changed)
+   {
+      return;
+   }
+
+   time = Frame_GetScanStart() + Frame_GetScanDuration();
+   for(index = 0; index < DEF_NUM_SENSORS; index++)
+   {
+      if(changed & (1 << index))
+      {
+         recordBegin(BINARY_RECORD_EVENT, 8);
+         recordPut(index);
+         recordPut((state & (1 << index)) ? 1 : 0);
+         recordPut(time & 0xFF);
+         recordPut((time >> 8) & 0xFF);
+         recordPut((time >> 16) & 0xFF);
+         recordPut(time >> 24);
+         recordEnd();
+      }
+   }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// itemFirst, itemNext
+//-----------------------------------------------------------------------------
+//
+// Walk the values of the fields in recordFields in data record order.  Call
+// itemFirst(), then itemNext() returns 1 for each value with itemField and
+// itemChannel set, and 0 at the end.
+//
+void itemFirst(void)
+{
+   itemField = 0;
+   itemChannel = 0xFF;
+}
+
+uint8_t itemNext(void)
+{
+   while(itemField < BINARY_FIELDS)
+   {
+      if(recordFields & (1 << binaryFields[itemField].id))
+      {
+         if(binaryFields[itemField].offset == GLOBAL)
+         {
+            if(itemChannel == 0xFF)
+            {
+               itemChannel = 0;
+               return 1;
+            }
+         }
+         else
+         {
+            // Starts from 0xFF, so the first increment gives channel 0
+            while(++itemChannel < DEF_NUM_SENSORS)
+            {
+               if(profilerChannelMask & (1 << itemChannel))
+               {
+                  return 1;
+               }
+            }
+         }
+      }
+
+      itemField++;
+      itemChannel = 0xFF;
+   }
+
+   return 0;
+}
+
+//-----------------------------------------------------------------------------
+// itemValue
+//-----------------------------------------------------------------------------
+//
+// Returns the value itemNext() is on.
+//
+uint16_t itemValue(void)
+{
+   uint8_t index;
+   uint8_t mask;
+   uint8_t xdata *ptr;
+   uint16_t value = 0;
+
+   if(binaryFields[itemField].offset != GLOBAL)
+   {
+      ptr = (uint8_t xdata *)&CSLIB_node[itemChannel]
+            + offsetArray[binaryFields[itemField].offset];
+      if(binaryFields[itemField].width == 1)
+      {
+         return *ptr;
+      }
+      return *(uint16_t xdata *)ptr;
+   }
+
+   switch(binaryFields[itemField].id)
+   {
+      case 3:
+      case 4:
+         mask = (binaryFields[itemField].id == 3)
+                ? SINGLE_ACTIVE_MASK : DEBOUNCE_ACTIVE_MASK;
+         for(index = 0; index < DEF_NUM_SENSORS; index++)
+         {
+            if(CSLIB_node[index].activeIndicator & mask)
+            {
+               value |= (1 << index);
+            }
+         }
+         value &= profilerChannelMask;
+         break;
+      case 8:
+         value = CSLIB_systemNoiseAverage;
+         break;
+      case 9:
+         value = CSLIB_activeSensorDelta;
+         break;
+      default:
+         value = CSLIB_inactiveSensorDelta;
+         break;
+   }
+
+   return value;
+}
+
+//-----------------------------------------------------------------------------
+// cobsPut
+//-----------------------------------------------------------------------------
+//
+// COBS encodes one byte straight into the transmit buffer.  A zero, or a
+// run reaching COBS_MAX_RUN, fills in the code byte of the run and reserves
+// the next one.
+//
+void cobsPut(uint8_t value)
+{
+   if(value != 0)
+   {
+      commPutByte(value);
+      cobsRun++;
+      if(cobsRun < COBS_MAX_RUN)
+      {
+         return;
+      }
+   }
+
+   commPatchByte(cobsCode, cobsRun + 1);
+   cobsCode = commReserveByte();
+   cobsRun = 0;
+}
+
+//-----------------------------------------------------------------------------
+// recordBegin
+//-----------------------------------------------------------------------------
+//
+// Starts a record of <length> bytes, not counting the CRC.
+//
+void recordBegin(uint8_t type, uint8_t length)
+{
+   recordCrc = 0xFFFF;
+   cobsCode = commReserveByte();
+   cobsRun = 0;
+
+   recordPut(type);
+   recordPut(length);
+}
+
+//-----------------------------------------------------------------------------
+// recordPut
+//-----------------------------------------------------------------------------
+//
+// Adds a byte to the record and to its CRC.
+//
+void recordPut(uint8_t value)
+{
+   recordCrc = (recordCrc << 4) ^ crcNibble[(recordCrc >> 12) ^ (value >> 4)];
+   recordCrc = (recordCrc << 4) ^ crcNibble[(recordCrc >> 12) ^ (value & 0x0F)];
+   cobsPut(value);
+}
+
+//-----------------------------------------------------------------------------
+// recordEnd
+//-----------------------------------------------------------------------------
+//
+// Appends the CRC, closes the last COBS run and the record.
+//
+void recordEnd(void)
+{
+   uint16_t crc = recordCrc;
+
+   cobsPut(crc & 0xFF);
+   cobsPut(crc >> 8);
+   commPatchByte(cobsCode, cobsRun + 1);
+   commPutByte(0);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/**************************************************************************//**
+ * Copyright (c) 2015 by Silicon Laboratories Inc. All rights reserved.
+ *
+ * http://developer.silabs.com/legal/version/v11/Silicon_Labs_Software_License_Agreement.txt
+ *****************************************************************************/
+
+#ifndef _PROFILER_BINARY_H
+#define _PROFILER_BINARY_H
+
+#include <si_toolchain.h>
+
+// Record types, the first byte of every record
+#define BINARY_RECORD_SCHEMA     0x01
+#define BINARY_RECORD_DATA       0x02
+#define BINARY_RECORD_DELTA      0x03
+#define BINARY_RECORD_REPLY      0x04
+#define BINARY_RECORD_EVENT      0x05
+#define BINARY_RECORD_WHEEL      0x06
+#define BINARY_RECORD_GESTURE    0x07
+#define BINARY_RECORD_RECORDER   0x08
+#define BINARY_RECORD_RECORDER_FRAME 0x09
+#define BINARY_RECORD_RECORDER_EVENT 0x0A
+#define BINARY_RECORD_POWER      0x0B
+
+// Layout version carried in the schema record
+#define BINARY_SCHEMA_VERSION    4
+
+// Width byte of a schema entry for a 16-bit bitmap with one bit per channel
+#define BINARY_WIDTH_BITMAP      0x82
+
+void binarySendSchema(void);
+void binarySendReply(uint8_t command, uint8_t status, uint16_t value);
+void binaryCommUpdate(void);
+void binarySendPower(void);
+
+// Record encoder, also used by event_output.c and command_interface.c
+void recordBegin(uint8_t type, uint8_t length);
+void recordPut(uint8_t value);
+void recordEnd(void);
+
+#endif
@@ -11,6 +11,9 @@
 //#include "SliderLibrary.h"
 //#include "SliderConfig.h"
 #include "cslib_sensor_descriptors.h"
+#include "profiler_binary.h"
+#include "command_interface.h"
+#include "tick.h"
 //#include "SliderDescriptors.h"
 
 void printOutput(uint16_t offset, uint8_t bytes);
@@ -42,6 +45,10 @@ idata HeaderStruct_t headerEntries[HEADER_TYPE_COUNT] = {
 
 idata uint8_t offsetArray[HEADER_TYPE_COUNT];
 
+#define PROFILER_ALL_FIELDS      ((1 << HEADER_TYPE_COUNT) - 1)
+#define PROFILER_ALL_CHANNELS    ((1 << DEF_NUM_SENSORS) - 1)
+#define FIELD_SELECTED(id)       (profilerFieldMask & (1 << (id)))
+
 
 //-----------------------------------------------------------------------------
 // Local variables and macros
@@ -62,12 +69,36 @@ uint8_t needANewLine = 0;                 // Flag to tell output to add a
 // before the header is ever sent again.
 uint8_t sendHeader = 1;
 
+uint16_t profilerBytes = 0;
+uint16_t profilerMicros = 0;
+
+// Fields and channels sent, bits in headerEntries[] and sensor order
+uint16_t profilerFieldMask = PROFILER_ALL_FIELDS;
+uint16_t profilerChannelMask = PROFILER_ALL_CHANNELS;
+
+// Send a field only every profilerDecimation[] frames, 0 and 1 send it on
+// every frame.  profilerDueMask has the fields due on this frame.
+xdata uint8_t profilerDecimation[HEADER_TYPE_COUNT];
+xdata uint8_t decimationCount[HEADER_TYPE_COUNT];
+uint16_t profilerDueMask = PROFILER_ALL_FIELDS;
+
+// Cleared by the host to pause the output, see commandPoll()
+uint8_t profilerStreaming = 1;
+
+#if POWER_STATS_ENABLE
+// Frames between two power statistics lines or records
+#define POWER_PRINT_FRAMES 250
+uint8_t powerPrintCount = 0;
+#endif
+
 //-----------------------------------------------------------------------------
 // Local function prototypes
 //-----------------------------------------------------------------------------
 
 void printHeader(void);               // Generates and outputs a header
                                        // describing the data in the stream
+void calculateOffsets(void);
+void updateDueMask(void);
 
 
 //-----------------------------------------------------------------------------
@@ -86,37 +117,70 @@ void printHeader(void);               // Generates and outputs a header
 void CSLIB_commUpdate(void)
 {
    uint16_t SI_SEG_XDATA value;
+   uint32_t start = Tick_GetMicros();
+
+   commByteCount = 0;
 
-   // This is set during device initialization as a one-shot
+   // Replies to host commands go out with this frame
+   commandPoll();
+   if(!profilerStreaming || PROFILER_EVENTS_ONLY)
+   {
+      commFrameEnd();
+      return;
+   }
+
+   updateDueMask();
+
+   // This is set during device initialization and after a command
    if(sendHeader == 1)
    {
+#if PROFILER_BINARY
+      calculateOffsets();
+      binarySendSchema();
+#else
+#if COMM_FORMAT_BENCHMARK
+      commFormatBenchmark();
+#endif
       printHeader();
+#endif
       sendHeader = 0;
    }
 
-#if OUTPUT_MODE == FULL_OUTPUT_RX_FROM_SENSOR
+#if PROFILER_BINARY
+
+   binaryCommUpdate();
+
+#elif OUTPUT_MODE == FULL_OUTPUT_RX_FROM_SENSOR
 
 
    printBase = (uint16_t)&CSLIB_node[0];
    printSize = sizeof(CSLIB_node[0]);
    printCount = DEF_NUM_SENSORS;
+   printMask = profilerChannelMask;
 
    //"BASELINE",
-   printOutput(offsetArray[0], 2);
+   if(FIELD_SELECTED(0))
+      printOutput(offsetArray[0], 2);
    //"RAW",
-   printOutput(offsetArray[1], 2);
+   if(FIELD_SELECTED(1))
+      printOutput(offsetArray[1], 2);
    //"PROCESS",
-   printOutput(offsetArray[2], 2);
+   if(FIELD_SELECTED(2))
+      printOutput(offsetArray[2], 2);
    //"SINGACT",
-   printOutputSingAct(offsetArray[3], 1);
+   if(FIELD_SELECTED(3))
+      printOutputSingAct(offsetArray[3], 1);
    //"DEBACT",
-   printOutputDebAct(offsetArray[4], 1);
+   if(FIELD_SELECTED(4))
+      printOutputDebAct(offsetArray[4], 1);
    //"TDELTA",
-   printOutputTDelta(offsetArray[5], 1);
+   if(FIELD_SELECTED(5))
+      printOutputTDelta(offsetArray[5], 1);
    //"NOISE",
   // printOutput(offsetArray[6], 1);
    //"EXPVAL",
-   printOutput(offsetArray[7], 2);
+   if(FIELD_SELECTED(6))
+      printOutput(offsetArray[7], 2);
    /*
    //"SLIDER"
    printBase = &Slider;
@@ -126,34 +190,127 @@ void CSLIB_commUpdate(void)
    printSize = 1;
    printBase = (uint16_t)&value;
    printCount = DEF_NUM_SENSORS;
-   printOutput(0, 1);
+   if(FIELD_SELECTED(7))
+      printOutput(0, 1);
+
+   printMask = 0xFFFF;
    //"noise est"
    value = (uint16_t)CSLIB_systemNoiseAverage;
    printSize = 2;
    printBase = (uint16_t)&value;
    printCount = 1;
-   printOutput(0, 2);
+   if(FIELD_SELECTED(8))
+      printOutput(0, 2);
 
    //"ACT_THR"
    value = (uint16_t)CSLIB_activeSensorDelta;
    printSize = 2;
    printBase = (uint16_t)&value;
    printCount = 1;
-   printOutput(0, 2);
+   if(FIELD_SELECTED(9))
+      printOutput(0, 2);
 
    //"INACT_THR"
    value = (uint16_t)CSLIB_inactiveSensorDelta;
    printSize = 2;
    printBase = (uint16_t)&value;
    printCount = 1;
-   printOutput(0, 2);
+   if(FIELD_SELECTED(10))
+      printOutput(0, 2);
 
    outputNewLine();
 
 #endif
 
+#if POWER_STATS_ENABLE
+   if(++powerPrintCount >= POWER_PRINT_FRAMES)
+   {
+      powerPrintCount = 0;
+#if PROFILER_BINARY
+      binarySendPower();
+#else
+      printPowerStats();
+#endif
+   }
+#endif
 
+   commFrameEnd();
 
+   profilerBytes = commByteCount;
+   profilerMicros = Tick_GetMicros() - start;
+}
+
+//-----------------------------------------------------------------------------
+// profilerSelect
+//-----------------------------------------------------------------------------
+//
+// Picks the fields and channels sent, bits in headerEntries[] and sensor
+// order.  The header is sent again to describe the new output.
+//
+void profilerSelect(uint16_t fields, uint16_t channels)
+{
+   profilerFieldMask = fields & PROFILER_ALL_FIELDS;
+   profilerChannelMask = channels & PROFILER_ALL_CHANNELS;
+   sendHeader = 1;
+}
+
+//-----------------------------------------------------------------------------
+// profilerDecimate
+//-----------------------------------------------------------------------------
+//
+// Sends a field only every <factor> frames.  Text output keeps a fixed set
+// of columns, so it ignores the decimation.  Returns 0 for an unknown field.
+//
+uint8_t profilerDecimate(uint8_t field, uint8_t factor)
+{
+   if(field >= HEADER_TYPE_COUNT)
+   {
+      return 0;
+   }
+
+   profilerDecimation[field] = factor;
+   decimationCount[field] = 0;
+   sendHeader = 1;
+   return 1;
+}
+
+//-----------------------------------------------------------------------------
+// profilerRestart
+//-----------------------------------------------------------------------------
+//
+// Sends the header again with the next frame.
+//
+void profilerRestart(void)
+{
+   sendHeader = 1;
+}
+
+//-----------------------------------------------------------------------------
+// updateDueMask
+//-----------------------------------------------------------------------------
+//
+// Counts down the decimation of every field and sets profilerDueMask.
+//
+void updateDueMask(void)
+{
+   uint8_t index;
+
+   profilerDueMask = 0;
+   for(index = 0; index < HEADER_TYPE_COUNT; index++)
+   {
+      if(decimationCount[index])
+      {
+         decimationCount[index]--;
+      }
+      else
+      {
+         profilerDueMask |= 1 << index;
+         if(profilerDecimation[index])
+         {
+            decimationCount[index] = profilerDecimation[index] - 1;
+         }
+      }
+   }
 }
 
 
@@ -219,10 +376,14 @@ void printHeader(void)
    outputBeginHeader();
 
 #if OUTPUT_MODE == FULL_OUTPUT_RX_FROM_SENSOR
+   printMask = profilerChannelMask;
    for(index = 0; index < HEADER_TYPE_COUNT; index++)
    {
-      outputHeaderCount(headerEntries[index]);
-      outputBreak();
+      if(FIELD_SELECTED(index))
+      {
+         outputHeaderCount(headerEntries[index]);
+         outputBreak();
+      }
    }
 #endif
 
@@ -19,6 +19,42 @@
 #define OUTPUT_MODE FULL_OUTPUT_RX_FROM_SENSOR
 void CSLIB_commUpdate(void);
 
+// Set to 1 to send the FULL_OUTPUT_RX_FROM_SENSOR data as COBS framed binary
+// records instead of text.  The record format is in profiler_binary.c.
+// Binary records are queued and sent from the UART interrupt.  The text
+// output blocks the frame until each line is sent, see COMM_TX_RING.
+#define PROFILER_BINARY 0
+
+// Set to 1 to send binary data records only as key frames, with delta
+// records in between, once every PROFILER_KEYFRAME_INTERVAL records
+#define PROFILER_DELTA 1
+#define PROFILER_KEYFRAME_INTERVAL 50
+
+// Set to 1 to send touch, wheel and gesture event records as they happen,
+// ahead of the queued data records.  Needs PROFILER_BINARY, see
+// event_output.c.  PROFILER_EVENTS_ONLY leaves the data records out.
+#define PROFILER_EVENTS 0
+#define PROFILER_EVENTS_ONLY 0
+
+// Bytes sent and time taken in microseconds by the last CSLIB_commUpdate(),
+// to compare the output modes
+extern uint16_t profilerBytes;
+extern uint16_t profilerMicros;
+
+extern idata uint8_t offsetArray[];
+
+// Run time selection of the output, the host sets it with the commands in
+// command_interface.c
+void profilerSelect(uint16_t fields, uint16_t channels);
+uint8_t profilerDecimate(uint8_t field, uint8_t factor);
+void profilerRestart(void);
+
+extern uint8_t profilerStreaming;
+extern uint16_t profilerFieldMask;
+extern uint16_t profilerChannelMask;
+extern uint16_t profilerDueMask;
+extern xdata uint8_t profilerDecimation[];
+
 
 // FULL_OUTPUT_RX_FROM_SENSOR.  This setting uses real sensor data
 // and outputs most algorithmic data for analysis.
@@ -7,17 +7,128 @@
 #include "circle_slider.h"
 #include "cslib_config.h"
 #include "cslib.h"
+#include "settings.h"
+#include "scheduler.h"
 
+// Current classification of the wheel touch, one of SLIDER_STATE_*
+static uint8_t state = SLIDER_STATE_NONE;
 
-void SetLedIntensity(uint8_t intensity) {
-    if (intensity == 0)
-    {
-        PCA0CPM0 &= ~PCA0CPM0_ECOM__ENABLED;
-    }
-    else
-    {
-        PCA0CPH0 = 255-intensity;
-    }
+// Frames left before a single touch may move the LED again after a
+// two-touch or ambiguous touch
+static uint8_t holdoff = 0;
+
+// Latest two-touch spread and the value the current gesture is measured from
+static uint8_t spread = 0;
+static uint8_t spreadStart = 0;
+
+// Last pinch/spread gesture not yet collected by circle_slider_getGesture()
+static uint8_t gesture = SLIDER_GESTURE_NONE;
+
+// Angle of a settled single touch in the last frame, or SLIDER_NO_ANGLE
+static uint16_t wheelAngle = SLIDER_NO_ANGLE;
+
+// Learned full touch delta of each pad, see LearnPadPeak(). Stored in the
+// settings record by circle_slider_storePeaks().
+static uint8_t padPeak[3];
+
+// Per-pad gain that scales a touch delta to normalized units, in 1/64ths.
+// Derived from the learned peak delta of each pad in padPeak[].
+static uint8_t padGain[3];
+
+// Counts single-touch frames towards the next peak decay step of each pad
+static uint8_t peakDecay[3];
+
+// Degrees between two LED_ANGLE_LEVEL[] entries, as a power of two
+#define LED_ANGLE_SHIFT 2
+#define LED_ANGLE_STEPS (360 >> LED_ANGLE_SHIFT)
+
+// Wheel LED brightness every 4 degrees of the wheel, fading from full at
+// 12 o'clock to off just before it. UpdateLed() interpolates in between,
+// which stays within 2/8 of a PWM count of the curve. Gamma corrected (2.2)
+// so equal steps around the wheel look like equal brightness steps.
+// Values are the LED on time (CEX0 low, the LED is active low) in 1/8ths
+// of an 11-bit PWM count: the top 11 bits go to the PCA and the low 3 bits
+// are dithered over successive PWM cycles, giving 14 bits of effective
+// resolution at the dim end. The last entry is 360 degrees, for the
+// interpolation.
+SI_SEGMENT_VARIABLE(LED_ANGLE_LEVEL[LED_ANGLE_STEPS + 1], uint16_t, SI_SEG_CODE) =
+{
+  16376, 15977, 15584, 15196, 14813, 14436, 14064, 13697, 13335, 12979, 12628, 12282,
+  11942, 11607, 11276, 10952, 10632, 10317, 10008,  9704,  9404,  9110,  8821,  8537,
+   8259,  7985,  7716,  7452,  7193,  6940,  6691,  6447,  6208,  5974,  5745,  5520,
+   5301,  5087,  4877,  4672,  4472,  4276,  4086,  3900,  3719,  3542,  3370,  3203,
+   3041,  2883,  2729,  2581,  2436,  2297,  2161,  2031,  1904,  1782,  1665,  1552,
+   1443,  1338,  1238,  1142,  1050,   962,   879,   800,   724,   653,   586,   523,
+    463,   408,   356,   308,   264,   224,   187,   154,   124,    98,    75,    55,
+     39,    25,    15,     8,     3,     0,     0
+};
+
+// Level the PCA interrupt is currently producing, see LED_ANGLE_LEVEL[]
+static volatile uint16_t ledLevel = 0;
+
+// Level last handed to the PCA interrupt by UpdateLed()
+static uint16_t lastLevel = 0;
+
+// Accumulates the fractional part of ledLevel between PWM cycles
+static uint8_t ledDither = 0;
+
+// Configure PCA channel 0 for 11-bit PWM with the compare value loaded
+// from the auto-reload registers at every PWM cycle overflow. The overflow
+// interrupt is only enabled by SetLedLevel() while there is a fraction to
+// dither, so a LED that is off or at a whole level costs no wakeups.
+void InitLedPwm(void) {
+  // Stop the PCA while its timebase changes. SYSCLK / 4 keeps the 11-bit
+  // PWM well above flicker frequency, and the 8-cycle dither pattern too.
+  PCA0CN0 &= ~PCA0CN0_CR__BMASK;
+  PCA0MD = (PCA0MD & ~PCA0MD_CPS__FMASK) | PCA0MD_CPS__SYSCLK_DIV_4;
+
+  // From here on PCA0CPL0/PCA0CPH0 address the auto-reload registers
+  PCA0PWM = PCA0PWM_ARSEL__AUTORELOAD | PCA0PWM_ECOV__COVF_MASK_DISABLED
+          | PCA0PWM_CLSEL__11_BITS;
+
+  PCA0CN0 |= PCA0CN0_CR__RUN;
+
+  EIE1 |= EIE1_EPCA0__ENABLED;
+}
+
+// Keep the wheel LED PWM rate when the clock governor divides SYSCLK.
+// SYSCLK / 4 at the fast clock is the same PCA clock as the undivided
+// SYSCLK at CLOCK_SLOW_SHIFT.
+void circle_slider_setClockShift(uint8_t shift) {
+  PCA0CN0 &= ~PCA0CN0_CR__BMASK;
+
+  if (shift)
+  {
+    PCA0MD = (PCA0MD & ~PCA0MD_CPS__FMASK) | PCA0MD_CPS__SYSCLK;
+  }
+  else
+  {
+    PCA0MD = (PCA0MD & ~PCA0MD_CPS__FMASK) | PCA0MD_CPS__SYSCLK_DIV_4;
+  }
+
+  PCA0CN0 |= PCA0CN0_CR__RUN;
+}
+
+// Hand a new drive level to the PCA interrupt
+void SetLedLevel(uint16_t level) {
+  // ledLevel is 16-bit, so keep the interrupt from seeing half an update
+  EIE1 &= ~EIE1_EPCA0__BMASK;
+  ledLevel = level;
+
+  if (level & 0x07)
+  {
+    // The PCA interrupt dithers the fraction over successive PWM cycles
+    PCA0PWM |= PCA0PWM_ECOV__COVF_MASK_ENABLED;
+  }
+  else
+  {
+    // A whole level is loaded once and the PCA repeats it on its own
+    PCA0PWM &= ~PCA0PWM_ECOV__BMASK;
+    PCA0CPL0 = (uint8_t)(level >> 3);
+    PCA0CPH0 = (uint8_t)(level >> 11);
+  }
+
+  EIE1 |= EIE1_EPCA0__ENABLED;
 }
 
 // Given an angle, normalize the angle
@@ -30,46 +141,144 @@ void NormalizeAngle(uint16_t* angle) {
 }
 
 // Update the LED brightness based on angle
-// angle [0, 359] => intensity [0, 255]
+// angle [0, 359] => level [16376, 0]
 void UpdateLed(uint16_t angle) {
-  static lastIntensity = 0;
+  uint8_t index = angle >> LED_ANGLE_SHIFT;
+  uint16_t level = LED_ANGLE_LEVEL[index];
 
-  // 256 / 360 reduces to 32 / 45
-  uint8_t intensity = angle * 32 / 45;
+  // The curve only falls, and never by more than a few hundred between
+  // two entries, so the product fits in 16 bits
+  level -= ((level - LED_ANGLE_LEVEL[index + 1])
+            * (angle & ((1 << LED_ANGLE_SHIFT) - 1))) >> LED_ANGLE_SHIFT;
 
-  if (intensity != lastIntensity)
+  if (level != lastLevel)
   {
-    SetLedIntensity(intensity);
-    lastIntensity = intensity;
+    SetLedLevel(level);
+    lastLevel = level;
   }
 }
 
-bool IsTouchQualified(void) {
-  uint8_t sensor_index;
-  uint16_t touch_sum = 0;
+// Read the raw touch delta of each wheel pad into deltas[]
+void ReadDeltas(uint16_t* deltas) {
+    uint8_t sensor_index;
 
-  // Only update the slider if at least one of the CS0 channels is active
-  if (CSLIB_isSensorDebounceActive(0) ||
-      CSLIB_isSensorDebounceActive(1) ||
-      CSLIB_isSensorDebounceActive(2))
-  {
     // For each sensor, calculate the delta between the current
     // capacitance value and baseline capacitance value, or delta
     for (sensor_index = 0; sensor_index < 3; sensor_index++)
     {
-        if (CSLIB_node[sensor_index].processBuffer[0] >= CSLIB_node[sensor_index].currentBaseline)
+        if (CSLIB_node[sensor_index].processBuffer[0] < CSLIB_node[sensor_index].currentBaseline)
+        {
+            deltas[sensor_index] = 0;
+        }
+        else
         {
-            touch_sum += ((CSLIB_node[sensor_index].processBuffer[0] - CSLIB_node[sensor_index].currentBaseline) >> 8);
+            deltas[sensor_index] = (CSLIB_node[sensor_index].processBuffer[0] - CSLIB_node[sensor_index].currentBaseline) >> 8;
         }
     }
+}
+
+// Recalculate the gain of one pad from its learned peak delta
+void UpdatePadGain(uint8_t sensor_index) {
+  uint16_t gain = ((uint16_t)PAD_NORMALIZED_PEAK << 6) / padPeak[sensor_index];
+
+  if (gain > 255)
+  {
+    gain = 255;
+  }
+
+  padGain[sensor_index] = (uint8_t)gain;
+}
+
+// Scale the raw deltas so that a finger squarely on any pad reads
+// PAD_NORMALIZED_PEAK. Without this the weakest pad drags the centroid
+// and the angle moves faster across some parts of the wheel than others.
+void NormalizeDeltas(uint16_t* raw, uint16_t* deltas) {
+  uint8_t sensor_index;
+  uint8_t delta;
+
+  for (sensor_index = 0; sensor_index < 3; sensor_index++)
+  {
+    delta = raw[sensor_index] > 255 ? 255 : (uint8_t)raw[sensor_index];
+    deltas[sensor_index] = ((uint16_t)delta * padGain[sensor_index]) >> 6;
+  }
+}
+
+// Track the peak delta of the pad under a single touch. The peak follows
+// a stronger touch immediately and drifts down slowly when touches stop
+// reaching it, so it settles on what a full touch of that pad reads.
+void LearnPadPeak(uint16_t* raw) {
+  uint8_t sensor_index = 0;
+  uint8_t* peak;
+
+  if (raw[1] > raw[sensor_index])
+  {
+    sensor_index = 1;
+  }
+  if (raw[2] > raw[sensor_index])
+  {
+    sensor_index = 2;
+  }
+
+  peak = &padPeak[sensor_index];
+
+  if (raw[sensor_index] > *peak)
+  {
+    *peak = raw[sensor_index] > 255 ? 255 : (uint8_t)raw[sensor_index];
+    peakDecay[sensor_index] = 0;
+    UpdatePadGain(sensor_index);
+  }
+  else if (++peakDecay[sensor_index] >= PAD_PEAK_DECAY_FRAMES)
+  {
+    peakDecay[sensor_index] = 0;
+
+    if (*peak > PAD_PEAK_MIN)
+    {
+      (*peak)--;
+      UpdatePadGain(sensor_index);
+    }
+  }
+}
+
+// Write the learned peaks to flash once they have moved far enough from
+// the stored copy. Called while the wheel is untouched so the page erase
+// never stalls an active touch.
+//
+// A peak that rose is saved at PAD_PEAK_SAVE_STEP, one that decayed only
+// at PAD_PEAK_SAVE_DROP. The decay runs whenever touches are light, and
+// the next firm touch raises the peak straight back, so saving small drops
+// would erase the page in most sessions for nothing.
+void SavePadPeaks(void) {
+  uint8_t sensor_index;
+  uint8_t stored;
+  uint8_t learned;
+
+  for (sensor_index = 0; sensor_index < 3; sensor_index++)
+  {
+    stored = SETTINGS_STORED->padPeak[sensor_index];
+    learned = padPeak[sensor_index];
+
+    if ((learned >= stored + PAD_PEAK_SAVE_STEP) ||
+        (learned + PAD_PEAK_SAVE_DROP <= stored))
+    {
+      Settings_Save();
+      return;
+    }
+  }
+}
 
+bool IsTouchQualified(uint16_t* deltas) {
+  // Only update the slider if at least one of the CS0 channels is active
+  if (CSLIB_isSensorDebounceActive(0) ||
+      CSLIB_isSensorDebounceActive(1) ||
+      CSLIB_isSensorDebounceActive(2))
+  {
     // Sum of touch deltas must reach a minimum threshold
     // before updating circle slider position.
     //
     // This helps reduce jumpiness when the touch
     // is being released due to non-linear capacitance
     // response
-    if (touch_sum > MIN_SUM_TOUCH)
+    if (deltas[0] + deltas[1] + deltas[2] > MIN_SUM_TOUCH)
     {
       return true;
     }
@@ -78,6 +287,53 @@ bool IsTouchQualified(void) {
   return false;
 }
 
+// Decide whether the wheel is being touched by one finger or by more.
+//
+// With only three pads every pad neighbours the other two, so two fingers
+// cannot be told apart by position alone. Instead we look at how much of
+// each pad is covered: one finger can fully load at most one pad (or half
+// load two when it sits between them), so two heavily loaded pads, an
+// abnormally large total, or load on all three pads means the centroid
+// would average unrelated contacts into a bogus angle.
+uint8_t ClassifyTouch(uint16_t* deltas) {
+  uint8_t high = 0;
+  uint8_t middle = 1;
+  uint8_t low = 2;
+  uint8_t swap;
+
+  // Order the pads by delta, strongest first
+  if (deltas[middle] > deltas[high])
+  {
+    swap = high; high = middle; middle = swap;
+  }
+  if (deltas[low] > deltas[middle])
+  {
+    swap = middle; middle = low; low = swap;
+  }
+  if (deltas[middle] > deltas[high])
+  {
+    swap = high; high = middle; middle = swap;
+  }
+
+  // Every pad is loaded, typically a palm or two fingers straddling pads
+  if (deltas[low] >= AMBIGUOUS_PAD_DELTA)
+  {
+    return SLIDER_STATE_AMBIGUOUS;
+  }
+
+  if (deltas[middle] >= TWO_TOUCH_PAD_DELTA ||
+      deltas[0] + deltas[1] + deltas[2] > MAX_SUM_TOUCH)
+  {
+    // Spread is how evenly the two contacts share their pads: it rises
+    // as the fingers move apart onto separate pads and falls as they
+    // pinch together onto one.
+    spread = (uint8_t)((deltas[middle] * 255UL) / deltas[high]);
+    return SLIDER_STATE_TWO_TOUCH;
+  }
+
+  return SLIDER_STATE_SINGLE;
+}
+
 // Perform the centroid algorithm to determine the wheel angle position
 // (0 degrees is 12 o'clock, 90 degrees is 3 o'clock)
 //
@@ -86,27 +342,11 @@ bool IsTouchQualified(void) {
 // CS1 CS2
 //   CS0
 //
-uint16_t CalculatePosition() {
-    uint8_t sensor_index;
+uint16_t CalculatePosition(uint16_t* deltas) {
     uint16_t angle = 0;
-    uint16_t deltas[3];
     uint16_t weights[3];
     uint16_t offset;
 
-    // For each sensor, calculate the delta between the current
-    // capacitance value and baseline capacitance value, or delta
-    for (sensor_index = 0; sensor_index < 3; sensor_index++)
-    {
-        if (CSLIB_node[sensor_index].processBuffer[0] < CSLIB_node[sensor_index].currentBaseline)
-        {
-            deltas[sensor_index] = 0;
-        }
-        else
-        {
-            deltas[sensor_index] = (CSLIB_node[sensor_index].processBuffer[0] - CSLIB_node[sensor_index].currentBaseline) >> 8;
-        }
-    }
-
     // CS0 touch delta is highest, perform weighted linear slider
     // binning algorithm to assign a value between 20 - 60
     if (deltas[0] >= deltas[2] &&
@@ -169,18 +409,167 @@ uint16_t CalculatePosition() {
     return angle;
 }
 
+void circle_slider_init(bool stored) {
+  uint8_t sensor_index;
+
+  InitLedPwm();
+
+  for (sensor_index = 0; sensor_index < 3; sensor_index++)
+  {
+    padPeak[sensor_index] = stored ? SETTINGS_STORED->padPeak[sensor_index]
+                                   : PAD_DEFAULT_PEAK;
+
+    if (padPeak[sensor_index] < PAD_PEAK_MIN)
+    {
+      padPeak[sensor_index] = PAD_PEAK_MIN;
+    }
+
+    UpdatePadGain(sensor_index);
+  }
+}
+
 void circle_slider_main() {
   uint16_t angle;
+  uint16_t raw[3];
+  uint16_t deltas[3];
+  uint8_t previousState = state;
+
+  wheelAngle = SLIDER_NO_ANGLE;
+
+  ReadDeltas(raw);
+  NormalizeDeltas(raw, deltas);
 
   // Check if sum of sensors is above a minimum threshold
   // for better touch release behaviour
-  if (IsTouchQualified())
+  if (!IsTouchQualified(deltas))
+  {
+    if (previousState != SLIDER_STATE_NONE)
+    {
+      Scheduler_Once(TASK_SETTINGS, PAD_PEAK_SAVE_DELAY);
+    }
+
+    state = SLIDER_STATE_NONE;
+    holdoff = 0;
+    return;
+  }
+
+  state = ClassifyTouch(deltas);
+
+  if (state == SLIDER_STATE_TWO_TOUCH)
+  {
+    if (previousState != SLIDER_STATE_TWO_TOUCH)
+    {
+      spreadStart = spread;
+    }
+    else if (spread >= spreadStart + SPREAD_GESTURE_STEP)
+    {
+      gesture = SLIDER_GESTURE_SPREAD;
+      spreadStart = spread;
+    }
+    else if (spread + SPREAD_GESTURE_STEP <= spreadStart)
+    {
+      gesture = SLIDER_GESTURE_PINCH;
+      spreadStart = spread;
+    }
+  }
+
+  if (state != SLIDER_STATE_SINGLE)
+  {
+    // Lifting one finger of a pair passes through a few frames that look
+    // like a single touch somewhere in between, so keep the LED still
+    // until the remaining touch has settled
+    holdoff = TWO_TOUCH_HOLDOFF;
+    return;
+  }
+
+  // The holdoff frames may still carry part of the second touch, keep
+  // them out of the learned peaks too
+  if (holdoff)
+  {
+    holdoff--;
+    return;
+  }
+
+  LearnPadPeak(raw);
+
+  // Perform the centroid algorithm to determine the wheel angle position
+  // (0 degrees is 12 o'clock, 90 degrees is 3 o'clock)
+  angle = CalculatePosition(deltas);
+  wheelAngle = angle;
+
+  // Update the LED brightness based on angle
+  UpdateLed(angle);
+}
+
+// Settings task, queued PAD_PEAK_SAVE_DELAY after a release. A touch that
+// came back meanwhile will queue it again when it ends.
+void circle_slider_savePeaks(void) {
+  if (state == SLIDER_STATE_NONE)
+  {
+    SavePadPeaks();
+  }
+}
+
+// Write the learned peaks into the new settings record, called by
+// Settings_Save()
+void circle_slider_storePeaks(void) {
+  uint8_t sensor_index;
+
+  for (sensor_index = 0; sensor_index < 3; sensor_index++)
+  {
+    Settings_Put(&SETTINGS_STORED->padPeak[sensor_index], padPeak[sensor_index]);
+  }
+}
+
+void circle_slider_ledOff(void) {
+  lastLevel = 0;
+  SetLedLevel(0);
+}
+
+uint8_t circle_slider_getState(void) {
+  return state;
+}
+
+uint16_t circle_slider_getAngle(void) {
+  return wheelAngle;
+}
+
+uint8_t circle_slider_getSpread(void) {
+  if (state != SLIDER_STATE_TWO_TOUCH)
   {
-    // Perform the centroid algorithm to determine the wheel angle position
-    // (0 degrees is 12 o'clock, 90 degrees is 3 o'clock)
-    angle = CalculatePosition();
+    return 0;
+  }
+
+  return spread;
+}
+
+uint8_t circle_slider_getGesture(void) {
+  uint8_t result = gesture;
+
+  gesture = SLIDER_GESTURE_NONE;
+
+  return result;
+}
+
+// Runs once per PWM cycle and loads the compare value for the next one.
+// The fractional bits of the level are accumulated so the PCA alternates
+// between the two nearest 11-bit codes in the right proportion.
+SI_INTERRUPT (PCA0_ISR, PCA0_IRQn) {
+  uint16_t level = ledLevel;
+
+  PCA0PWM &= ~PCA0PWM_COVF__BMASK;
 
-    // Update the LED brightness based on angle
-    UpdateLed(angle);
+  ledDither += (uint8_t)level & 0x07;
+  level >>= 3;
+
+  if (ledDither & 0x08)
+  {
+    ledDither &= 0x07;
+    level++;
   }
+
+  // CEX0 is low, and the LED on, while the PCA count is below the
+  // compare value, so the level is the compare value itself
+  PCA0CPL0 = (uint8_t)level;
+  PCA0CPH0 = (uint8_t)(level >> 8);
 }
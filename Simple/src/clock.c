@@ -0,0 +1,78 @@
+/**
+ * @file clock.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Clock governor. The core runs slow, the low power oscillator divided by
+ * 1 << CLOCK_SLOW_SHIFT, unless a piece of work has asked for the fast
+ * clock. Scanning and idling happen at the slow clock, and the slider maths
+ * or a UART burst ask for the fast one around their work.
+ *
+ * Requests are counted so nested users don't drop the clock under each
+ * other. Timer 3 and the PCA clock are rescaled on every switch so the
+ * tick and the wheel LED keep their rate, and the LED PWM and UART pick up
+ * the new divider from Clock_Shift. The LED PWM coarsens its brightness
+ * steps at the slow clock rather than holding the fast one, see
+ * LedPwm_SetClockShift().
+ */
+#include "main.h"
+#include "clock.h"
+
+#if COMM_ENABLE
+#include "comm_routines.h"
+#endif
+
+uint8_t Clock_Shift = 0;
+
+/**
+ * number of outstanding CLOCK_FAST requests
+ */
+static uint8_t FastRequests = 0;
+
+/**
+ * @brief Switch SYSCLK to the low power oscillator divided by 1 << shift
+ */
+static void Clock_Set(uint8_t shift) {
+	if (shift == Clock_Shift) {
+		return;
+	}
+
+	CLKSEL = (shift << CLKSEL_CLKDIV__SHIFT) | CLKSEL_CLKSL__LPOSC;
+
+	while ((CLKSEL & CLKSEL_CLKRDY__BMASK) != CLKSEL_CLKRDY__SET);
+
+	Clock_Shift = shift;
+	Tick_SetClockShift(shift);
+	circle_slider_setClockShift(shift);
+	LedPwm_SetClockShift(shift);
+
+#if COMM_ENABLE
+	UART0_updateBaud();
+#endif
+}
+
+/**
+ * @brief Drop to the slow clock, call after the peripherals are set up
+ */
+void Clock_Init(void) {
+	FastRequests = 0;
+	Clock_Set(CLOCK_SLOW_SHIFT);
+}
+
+/**
+ * @brief Ask for a clock level until the matching Clock_Release()
+ */
+void Clock_Request(uint8_t level) {
+	if (level == CLOCK_FAST && FastRequests++ == 0) {
+		Clock_Set(0);
+	}
+}
+
+/**
+ * @brief Give up a clock level asked for with Clock_Request()
+ */
+void Clock_Release(uint8_t level) {
+	if (level == CLOCK_FAST && FastRequests && --FastRequests == 0) {
+		Clock_Set(CLOCK_SLOW_SHIFT);
+	}
+}
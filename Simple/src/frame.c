@@ -0,0 +1,347 @@
+/**
+ * @file frame.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Frame governor. A frame is one scan and slider update; the scheduler
+ * starts one every Frame_GetPeriod() milliseconds and the core idles
+ * through the slack in between.
+ *
+ * The period drops straight to the active period on a touch and
+ * stays there for a while after the release, as a new touch often follows.
+ * The busier the recent touch history, the longer it stays. It then backs
+ * off an eighth at a time towards 1000 / FRAME_RATE_IDLE, but never so far
+ * that a new touch would take more than FRAME_MAX_LATENCY to debounce.
+ * The period is also handed to cslib as its active mode period, the device
+ * layer moves the RTC alarm to it on the next sleep. The active
+ * period itself can be tuned at run time, see Frame_SetActivePeriod().
+ *
+ * Each frame is timed with Tick_GetMicros(), leaving out any time the core
+ * slept in CSLIB_lowPowerUpdate(). Conversion suspend counts, the scan
+ * takes that long. The longest frame bounds the idle period. With the
+ * serial interface built in, the tuning figures are also kept: the worst
+ * start time error (jitter), the share of the time spent in frames (duty)
+ * and the frame count, with the share of frames saved over a fixed active
+ * rate. They are read with the DIAGNOSTIC_FRAME_ commands.
+ *
+ * The device layer also reports each scan to Frame_ScanDone(), which
+ * numbers the scans and keeps the start and duration of the last one for
+ * the profiler records, again only with the serial interface.
+ */
+#include "main.h"
+#include "cslib_config.h"
+#include "cslib.h"
+#include "frame.h"
+
+#define FRAME_PERIOD_ACTIVE	(1000 / FRAME_RATE_ACTIVE)
+#define FRAME_PERIOD_IDLE	(1000 / FRAME_RATE_IDLE)
+
+/**
+ * frame period in ms while touched, FRAME_PERIOD_ACTIVE unless tuned
+ */
+static uint8_t ActivePeriod = FRAME_PERIOD_ACTIVE;
+
+/**
+ * current frame period in ms
+ */
+static uint8_t Period = FRAME_PERIOD_ACTIVE;
+
+/**
+ * frames since the last touch
+ */
+static uint8_t IdleFrames = 0;
+
+/**
+ * touch history, goes up with every touched frame and leaks away while
+ * the period backs off
+ */
+static uint8_t Activity = 0;
+
+/**
+ * Tick_GetMicros() and Tick_GetSleptMicros() at the start of the running
+ * frame
+ */
+static uint32_t FrameStart = 0;
+static uint32_t FrameSlept = 0;
+
+/**
+ * longest frame in us since Frame_ClearStats()
+ */
+static uint16_t Worst = 0;
+
+#if COMM_ENABLE
+/**
+ * Tick_GetMicros() at the start of the previous frame
+ */
+static uint32_t LastStart = 0;
+
+/**
+ * tuning figures since Frame_ClearStats(), see the getters
+ */
+static uint16_t Jitter = 0;
+static uint32_t Busy = 0;
+static uint32_t StatsStart = 0;
+static uint16_t Count = 0;
+
+/**
+ * last scan, see Frame_ScanDone()
+ */
+static uint16_t Sequence = 0;
+static uint32_t ScanStart = 0;
+static uint16_t ScanDuration = 0;
+#endif
+
+/**
+ * @brief Work out the period of the next frame from the touch history
+ */
+static uint8_t Frame_NextPeriod(bool active) {
+	uint16_t limit;
+	uint8_t period;
+
+	if (active) {
+		IdleFrames = 0;
+		Activity = (Activity > 0xFF - FRAME_ACTIVITY_STEP) ? 0xFF : Activity + FRAME_ACTIVITY_STEP;
+		return ActivePeriod;
+	}
+
+	// stay fast for a while after a release, longer after a busy spell
+	if (IdleFrames < FRAME_HOLD_FRAMES + (Activity >> 3)) {
+		IdleFrames++;
+		return Period;
+	}
+
+	if (Activity) {
+		Activity--;
+	}
+
+	// A new touch needs CSLIB_buttonDebounce scans in a row to register,
+	// and the first may only start a whole period after it lands
+	limit = Worst / 1000;
+	limit = (limit < FRAME_MAX_LATENCY) ? (FRAME_MAX_LATENCY - limit) / CSLIB_buttonDebounce : 0;
+
+	if (limit > FRAME_PERIOD_IDLE) {
+		limit = FRAME_PERIOD_IDLE;
+	} else if (limit < ActivePeriod) {
+		limit = ActivePeriod;
+	}
+
+	period = Period + (Period >> 3) + 1;
+
+	return (period > limit) ? (uint8_t)limit : period;
+}
+
+/**
+ * @brief Start at the active rate
+ */
+void Frame_Init(void) {
+	Period = ActivePeriod;
+	IdleFrames = 0;
+	Activity = 0;
+#if COMM_ENABLE
+	LastStart = 0;
+#endif
+	Frame_ClearStats();
+}
+
+/**
+ * @brief Mark the start of a frame
+ */
+void Frame_Begin(void) {
+#if COMM_ENABLE
+	uint32_t error;
+#endif
+
+	FrameStart = Tick_GetMicros();
+	FrameSlept = Tick_GetSleptMicros();
+
+#if COMM_ENABLE
+	if (LastStart) {
+		error = FrameStart - LastStart;
+
+		// how far off the interval was from the period it was scheduled for
+		if (error > Period * 1000UL) {
+			error -= Period * 1000UL;
+		} else {
+			error = Period * 1000UL - error;
+		}
+
+		if (error > Jitter) {
+			Jitter = (error > 0xFFFF) ? 0xFFFF : (uint16_t)error;
+		}
+	}
+
+	LastStart = FrameStart;
+#endif
+}
+
+/**
+ * @brief Mark the end of a frame and work out the next period
+ *
+ * @param active true if anything is touched
+ *
+ * @return true if the period changed and the frame task needs rescheduling
+ */
+bool Frame_End(bool active) {
+	uint32_t time = (Tick_GetMicros() - FrameStart) - (Tick_GetSleptMicros() - FrameSlept);
+	uint8_t period;
+
+#if COMM_ENABLE
+	Busy += time;
+	Count++;
+#endif
+
+	if (time > Worst) {
+		Worst = (time > 0xFFFF) ? 0xFFFF : (uint16_t)time;
+	}
+
+	period = Frame_NextPeriod(active);
+
+	if (period == Period) {
+		return false;
+	}
+
+	Period = period;
+	CSLIB_activeModePeriod = period;
+
+#if COMM_ENABLE
+	// the interval to the next frame is a new period, not jitter
+	LastStart = 0;
+#endif
+
+	return true;
+}
+
+/**
+ * @brief Return the current frame period in ms
+ */
+uint8_t Frame_GetPeriod(void) {
+	return Period;
+}
+
+/**
+ * @brief Change the frame period used while touched
+ *
+ * @param period ms, no longer than 1000 / FRAME_RATE_IDLE
+ *
+ * @note the next touched frame picks it up
+ */
+void Frame_SetActivePeriod(uint8_t period) {
+	ActivePeriod = period;
+}
+
+/**
+ * @brief Return the frame period used while touched in ms
+ */
+uint8_t Frame_GetActivePeriod(void) {
+	return ActivePeriod;
+}
+
+/**
+ * @brief Return the longest frame in us
+ */
+uint16_t Frame_GetWorst(void) {
+	return Worst;
+}
+
+#if COMM_ENABLE
+/**
+ * @brief Return the worst error in us between the time a frame started and
+ * the time it should have
+ */
+uint16_t Frame_GetJitter(void) {
+	return Jitter;
+}
+
+/**
+ * @brief Return the time spent in frames, in parts per thousand
+ */
+uint16_t Frame_GetDuty(void) {
+	uint32_t elapsed = Tick_GetMicros() - StatsStart;
+
+	if (elapsed < 1000) {
+		return 0;
+	}
+
+	return (uint16_t)(Busy / (elapsed / 1000));
+}
+
+/**
+ * @brief Return the number of frames run
+ */
+uint16_t Frame_GetCount(void) {
+	return Count;
+}
+
+/**
+ * @brief Return the frames saved over running every Frame_GetActivePeriod()
+ *
+ * @return parts per thousand of the frames a fixed rate would have run
+ * since Frame_ClearStats()
+ */
+uint16_t Frame_GetSaved(void) {
+	uint32_t fixed = (Tick_GetMicros() - StatsStart) / (ActivePeriod * 1000UL);
+
+	if (fixed <= Count) {
+		return 0;
+	}
+
+	return (uint16_t)(((fixed - Count) * 1000) / fixed);
+}
+#endif
+
+/**
+ * @brief Record a finished scan of all the sensors
+ *
+ * @param start Tick_GetMicros() when the first sensor was started
+ * @param duration wall clock time of the scan in us, which Tick_GetMicros()
+ * can't give as Timer 3 stops while the core is suspended
+ *
+ * @note called by the device layer after the last sensor, only kept with
+ * the serial interface
+ */
+void Frame_ScanDone(uint32_t start, uint16_t duration) {
+#if COMM_ENABLE
+	Sequence++;
+	ScanStart = start;
+	ScanDuration = duration;
+#endif
+}
+
+#if COMM_ENABLE
+/**
+ * @brief Return the number of the last scan, counts up from 1 and wraps
+ */
+uint16_t Frame_GetSequence(void) {
+	return Sequence;
+}
+
+/**
+ * @brief Return Tick_GetMicros() at the start of the last scan
+ */
+uint32_t Frame_GetScanStart(void) {
+	return ScanStart;
+}
+
+/**
+ * @brief Return the wall clock time of the last scan in us
+ */
+uint16_t Frame_GetScanDuration(void) {
+	return ScanDuration;
+}
+#endif
+
+/**
+ * @brief Restart the tuning figures
+ *
+ * @note the longest frame starts again from the next one, until then the
+ * idle period is bounded as if frames took no time
+ */
+void Frame_ClearStats(void) {
+	Worst = 0;
+#if COMM_ENABLE
+	Count = 0;
+	Jitter = 0;
+	Busy = 0;
+	StatsStart = Tick_GetMicros();
+#endif
+}
@@ -0,0 +1,232 @@
+/**
+ * @file led_anim.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * LED effects for LED1 to LED5, run from the 1ms tick interrupt.
+ *
+ * An effect is a list of keyframes, each fading the LED from wherever it is
+ * to a new brightness over a number of frames. The breathe effect is
+ * generated from a half wave table instead. The foreground starts an
+ * effect by ID with LedAnim_Start() and the interrupt plays it from its
+ * next frame. The interrupt only sets the new levels, the main loop builds
+ * the PWM schedule from them, see LedPwm_Update().
+ */
+#include "main.h"
+#include "led_anim.h"
+
+/**
+ * effect flags
+ */
+#define LED_ANIM_LOOP		0x01
+#define LED_ANIM_WAVE		0x02
+
+/**
+ * fade to level over frames (at least 1)
+ */
+typedef struct {
+	uint8_t level;
+	uint8_t frames;
+} LedAnimKey_t;
+
+/**
+ * keyframes first to first + count - 1 of KEYFRAME
+ */
+typedef struct {
+	uint8_t first;
+	uint8_t count;
+	uint8_t flags;
+} LedAnimEffect_t;
+
+/**
+ * A fade is worked out from where it started on every frame rather than
+ * stepped, so the level needs no fraction bits. remaining counts the
+ * frames left of the keyframe, or the phase of the breathe curve.
+ */
+typedef struct {
+	uint8_t effect;
+	uint8_t key;
+	uint8_t remaining;
+	uint8_t from;
+	uint8_t level;
+} LedAnimChannel_t;
+
+static const SI_SEGMENT_VARIABLE(KEYFRAME[], LedAnimKey_t, SI_SEG_CODE) = {
+	// off, on
+	{0, 1}, {255, 1},
+	// fade in, fade out
+	{255, 25}, {0, 25},
+	// blink at 1Hz
+	{255, 1}, {255, 49}, {0, 1}, {0, 49},
+	// flash
+	{255, 1}, {255, 9}, {0, 20}
+};
+
+static const SI_SEGMENT_VARIABLE(EFFECT[LED_ANIM_COUNT], LedAnimEffect_t, SI_SEG_CODE) = {
+	{0, 1, 0},				// LED_ANIM_OFF
+	{1, 1, 0},				// LED_ANIM_ON
+	{2, 1, 0},				// LED_ANIM_FADE_IN
+	{3, 1, 0},				// LED_ANIM_FADE_OUT
+	{4, 4, LED_ANIM_LOOP},	// LED_ANIM_BLINK
+	{8, 3, 0},				// LED_ANIM_FLASH
+	{0, 0, LED_ANIM_WAVE}	// LED_ANIM_BREATHE
+};
+
+/**
+ * First half of the breathe curve. A period is 128 frames and mirrors
+ * about frame 64, see LedAnim_Breathe()
+ */
+static const SI_SEGMENT_VARIABLE(BREATHE[65], uint8_t, SI_SEG_CODE) = {
+	255, 255, 254, 252, 249, 246, 242, 238, 233, 227, 222, 216, 209, 202,
+	195, 187, 180, 172, 164, 157, 149, 141, 134, 126, 119, 112, 105, 98, 91,
+	85, 80, 74, 68, 63, 58, 53, 48, 45, 40, 37, 33, 30, 28, 24, 22, 20, 17,
+	15, 13, 12, 9, 8, 7, 6, 5, 3, 2, 2, 1, 1, 0, 0, 0, 0, 0
+};
+
+static SI_SEGMENT_VARIABLE(Channel[LED_PWM_COUNT], LedAnimChannel_t, SI_SEG_XDATA);
+
+/**
+ * milliseconds until the next frame
+ */
+static uint8_t FrameCount = 0;
+
+/**
+ * @brief Return the breathe curve at phase
+ */
+static uint8_t LedAnim_Breathe(uint8_t phase) {
+	phase &= 127;
+
+	if (phase > 64) {
+		phase = 128 - phase;
+	}
+
+	return BREATHE[phase];
+}
+
+/**
+ * @brief Start the fade towards the channel current keyframe
+ */
+static void LedAnim_LoadKey(LedAnimChannel_t xdata *channel) {
+	channel->from = channel->level;
+	channel->remaining = KEYFRAME[channel->key].frames;
+}
+
+/**
+ * @brief Move a channel on by one frame
+ */
+static void LedAnim_Frame(LedAnimChannel_t xdata *channel) {
+	LedAnimEffect_t code *effect = &EFFECT[channel->effect];
+	LedAnimKey_t code *key;
+	uint8_t distance;
+
+	if (effect->flags & LED_ANIM_WAVE) {
+		channel->level = LedAnim_Breathe(channel->remaining++);
+		return;
+	}
+
+	if (!channel->remaining) {
+		return;
+	}
+
+	key = &KEYFRAME[channel->key];
+
+	if (--channel->remaining) {
+		// the part of the fade still to go
+		if (key->level > channel->from) {
+			distance = ((uint16_t)(key->level - channel->from) * channel->remaining) / key->frames;
+			channel->level = key->level - distance;
+		} else {
+			distance = ((uint16_t)(channel->from - key->level) * channel->remaining) / key->frames;
+			channel->level = key->level + distance;
+		}
+		return;
+	}
+
+	channel->level = key->level;
+
+	if (++channel->key == effect->first + effect->count) {
+		if (!(effect->flags & LED_ANIM_LOOP)) {
+			return;
+		}
+
+		channel->key = effect->first;
+	}
+
+	LedAnim_LoadKey(channel);
+}
+
+/**
+ * @brief Play an effect on a LED
+ *
+ * @param led one of LED_PWM_LED1 to LED_PWM_LED5
+ * @param effect one of the LED_ANIM_ effect IDs
+ *
+ * @note the effect starts on the next frame. Asking for the effect that is
+ * already playing does nothing, so this can be called every loop.
+ */
+void LedAnim_Start(uint8_t led, uint8_t effect) {
+	LedAnimChannel_t xdata *channel;
+
+	if (led >= LED_PWM_COUNT || effect >= LED_ANIM_COUNT) {
+		return;
+	}
+
+	channel = &Channel[led];
+
+	if (channel->effect == effect) {
+		return;
+	}
+
+	// the tick interrupt plays the channel, keep it off while it changes
+	EIE1 &= ~EIE1_ET3__BMASK;
+
+	channel->effect = effect;
+	channel->key = EFFECT[effect].first;
+
+	if (EFFECT[effect].flags & LED_ANIM_WAVE) {
+		// start at the dark end of the curve
+		channel->remaining = 64;
+	} else {
+		LedAnim_LoadKey(channel);
+	}
+
+	EIE1 |= EIE1_ET3__ENABLED;
+}
+
+/**
+ * @brief Start every LED off
+ */
+void LedAnim_Init(void) {
+	uint8_t index;
+
+	for (index = 0; index < LED_PWM_COUNT; index++) {
+		Channel[index].effect = LED_ANIM_OFF;
+		Channel[index].remaining = 0;
+		Channel[index].level = 0;
+	}
+
+	FrameCount = LED_ANIM_FRAME_MS;
+}
+
+/**
+ * @brief Called from the tick interrupt every millisecond, runs a frame
+ * every LED_ANIM_FRAME_MS
+ */
+void LedAnim_Tick(void) {
+	LedAnimChannel_t xdata *channel;
+	uint8_t index;
+
+	if (--FrameCount) {
+		return;
+	}
+
+	FrameCount = LED_ANIM_FRAME_MS;
+
+	for (index = 0; index < LED_PWM_COUNT; index++) {
+		channel = &Channel[index];
+
+		LedAnim_Frame(channel);
+
+		LedPwm_Set(index, channel->level >> (8 - LED_PWM_BITS));
+	}
+}
@@ -0,0 +1,387 @@
+/**
+ * @file led_pwm.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Software PWM for LED1 to LED5 driven by Timer 2.
+ *
+ * Rather than interrupting at every PWM step, the period is split at the
+ * distinct brightness levels in use. At the start of a period every LED
+ * that isn't off is switched on, then each interrupt switches off all the
+ * LEDs whose level ends there and loads the timer with the distance to the
+ * next level. A period therefore costs one interrupt per distinct level
+ * plus one, no matter the resolution.
+ *
+ * The schedule is double buffered. LedPwm_Set() only marks the levels as
+ * changed, as the LED effects call it from the tick interrupt. The main
+ * loop then calls LedPwm_Update(), which builds the new schedule in the
+ * buffer the interrupt isn't using, and the interrupt switches to it at
+ * the next period boundary.
+ *
+ * At the slow clock a brightness step is shorter than the interrupt, so
+ * the schedule is built with the levels rounded to 1 << Clock_Shift steps.
+ * The edges then stay as far apart in time as at the fast clock, at the
+ * cost of the low bits of the brightness. A clock change to a slower level
+ * than the schedule was built for has it built again.
+ */
+#include "main.h"
+#include "led_pwm.h"
+
+/**
+ * define the LED pins. The LEDs are on when the pin is low.
+ */
+SI_SBIT (LED1, SFR_P0, 0);
+SI_SBIT (LED2, SFR_P2, 7);
+SI_SBIT (LED3, SFR_P1, 6);
+SI_SBIT (LED4, SFR_P1, 7);
+SI_SBIT (LED5, SFR_P1, 0);
+
+/**
+ * One period of the PWM.
+ *
+ * edge[0] to edge[count - 2] switch off the LEDs in their mask, in order of
+ * rising brightness. The last edge is the start of the next period and
+ * switches on the LEDs in its mask. steps[n] is the number of brightness
+ * steps, minus one, from the previous edge to edge n.
+ */
+typedef struct {
+	uint8_t count;
+	uint8_t steps[LED_PWM_COUNT + 1];
+	uint8_t mask[LED_PWM_COUNT + 1];
+} LedPwmSchedule_t;
+
+static SI_SEGMENT_VARIABLE(Schedule[2], LedPwmSchedule_t, SI_SEG_XDATA);
+
+/**
+ * brightness requested for each LED, written from the tick interrupt
+ */
+static SI_SEGMENT_VARIABLE(Level[LED_PWM_COUNT], uint8_t, SI_SEG_IDATA);
+
+/**
+ * set by LedPwm_Set() until LedPwm_Update() has built the new schedule
+ */
+static volatile bool Dirty = false;
+
+/**
+ * Clock_Shift the last schedule was built for
+ */
+static uint8_t BuiltShift = 0;
+
+/**
+ * schedule the interrupt is running, and the one it should switch to at
+ * the next period start (0xFF when there is none)
+ */
+static volatile uint8_t Active = 0;
+static volatile uint8_t Pending = 0xFF;
+
+/**
+ * edge the running timer interval ends on
+ */
+static uint8_t Edge = 0;
+
+#if LED_PWM_PROFILE
+/**
+ * Timer 3 counts spent in the interrupt, and the longest single run, at
+ * the fast clock rate whatever the clock was
+ */
+static volatile uint32_t IsrTime = 0;
+static volatile uint16_t IsrWorst = 0;
+static uint32_t ProfileStart = 0;
+#endif
+
+/**
+ * @brief Turn a number of brightness steps into a Timer 2 reload value,
+ * allowing for the SYSCLK divider
+ */
+#define LED_PWM_RELOAD(steps) (0 - ((uint16_t)((steps) + 1) << (LED_PWM_STEP_SHIFT - Clock_Shift)))
+
+/**
+ * @brief Build the schedule for the current levels into the free buffer
+ * and hand it to the interrupt
+ */
+static void LedPwm_Build(void) {
+	LedPwmSchedule_t xdata *schedule;
+	uint8_t levels[LED_PWM_COUNT];
+	uint8_t order[LED_PWM_COUNT];
+	uint8_t count = 0;
+	uint8_t index;
+	uint8_t insert;
+	uint8_t level;
+	uint8_t previous = 0;
+	uint8_t onMask = 0;
+	uint8_t quantum = 1 << Clock_Shift;
+
+	// Stop the interrupt from switching buffers, then the active one can't
+	// change under us and the other is ours to write
+	Pending = 0xFF;
+	schedule = &Schedule[Active ^ 1];
+	BuiltShift = Clock_Shift;
+
+	// The tick interrupt can set a level while this runs, work from a copy.
+	// A level set after the copy marks the schedule dirty again.
+	Dirty = false;
+	EIE1 &= ~EIE1_ET3__BMASK;
+
+	for (index = 0; index < LED_PWM_COUNT; index++) {
+		levels[index] = Level[index];
+	}
+
+	EIE1 |= EIE1_ET3__ENABLED;
+
+	// Sort the LEDs that need an off edge by level
+	for (index = 0; index < LED_PWM_COUNT; index++) {
+		level = levels[index];
+
+		if (level == 0) {
+			continue;
+		}
+
+		// Round to a whole quantum, a dimmed LED stays on and the top
+		// quantum goes fully on, it has no off edge
+		if (level > LED_PWM_MAX - (quantum >> 1)) {
+			level = LED_PWM_MAX;
+		} else {
+			level = (level + (quantum >> 1)) & ~(quantum - 1);
+
+			if (level == 0) {
+				level = quantum;
+			}
+		}
+
+		levels[index] = level;
+
+		onMask |= 1 << index;
+
+		if (level == LED_PWM_MAX) {
+			continue;
+		}
+
+		for (insert = count; insert && levels[order[insert - 1]] > level; insert--) {
+			order[insert] = order[insert - 1];
+		}
+
+		order[insert] = index;
+		count++;
+	}
+
+	// Merge LEDs with the same level into a single edge
+	schedule->count = 0;
+
+	for (index = 0; index < count; index++) {
+		level = levels[order[index]];
+
+		if (schedule->count && level == previous) {
+			schedule->mask[schedule->count - 1] |= 1 << order[index];
+			continue;
+		}
+
+		schedule->steps[schedule->count] = level - previous - 1;
+		schedule->mask[schedule->count] = 1 << order[index];
+		schedule->count++;
+		previous = level;
+	}
+
+	// The period start edge, LED_PWM_MAX + 1 steps after the period start
+	schedule->steps[schedule->count] = LED_PWM_MAX - previous;
+	schedule->mask[schedule->count] = onMask;
+	schedule->count++;
+
+	Pending = Active ^ 1;
+}
+
+/**
+ * @brief Set the brightness of a LED
+ *
+ * @param led one of LED_PWM_LED1 to LED_PWM_LED5
+ * @param level brightness from 0 (off) to LED_PWM_MAX (fully on)
+ *
+ * @note the change takes effect at the start of the PWM period after the
+ * next LedPwm_Update(). Only one context may call this, the LED effects
+ * call it from the tick interrupt
+ */
+void LedPwm_Set(uint8_t led, uint8_t level) {
+	if (led >= LED_PWM_COUNT || Level[led] == level) {
+		return;
+	}
+
+	Level[led] = level;
+	Dirty = true;
+}
+
+/**
+ * @brief Build the schedule if a level changed since the last call
+ *
+ * @note called from the main loop, so the sort never runs in an interrupt
+ */
+void LedPwm_Update(void) {
+	if (Dirty) {
+		LedPwm_Build();
+	}
+}
+
+/**
+ * @brief Have the schedule built again if the clock dropped below the one
+ * it was built for
+ *
+ * @param shift the SYSCLK divider is now 1 << shift
+ *
+ * @note called by the clock governor. The old schedule runs until the next
+ * LedPwm_Update(), a few of its edges may come late. A schedule built at
+ * the slow clock is kept at the fast one until a level changes.
+ */
+void LedPwm_SetClockShift(uint8_t shift) {
+	if (shift > BuiltShift) {
+		Dirty = true;
+	}
+}
+
+/**
+ * @brief Start the PWM with every LED off
+ */
+void LedPwm_Init(void) {
+	uint8_t index;
+
+	for (index = 0; index < LED_PWM_COUNT; index++) {
+		Level[index] = 0;
+	}
+
+	LED1 = LED2 = LED3 = LED4 = LED5 = 1;
+
+	Schedule[0].count = 1;
+	Schedule[0].steps[0] = LED_PWM_MAX;
+	Schedule[0].mask[0] = 0;
+	Active = 0;
+	Pending = 0xFF;
+	Edge = 0;
+#if LED_PWM_PROFILE
+	ProfileStart = Tick_GetCount();
+#endif
+
+	// 16-bit auto reload clocked from SYSCLK / 12
+	TMR2CN0 = TMR2CN0_T2XCLK__SYSCLK_DIV_12;
+	TMR2RL = LED_PWM_RELOAD(LED_PWM_MAX);
+	TMR2 = TMR2RL;
+	TMR2CN0 |= TMR2CN0_TR2__RUN;
+
+	IE |= IE_ET2__ENABLED;
+}
+
+#if LED_PWM_PROFILE
+/**
+ * @brief Report the PWM interrupt load since the previous call
+ *
+ * @param worstCase receives the longest single interrupt in microseconds
+ *
+ * @return interrupt time in parts per thousand of the wall time
+ */
+uint16_t LedPwm_GetIsrLoad(uint16_t *worstCase) {
+	uint32_t now = Tick_GetCount();
+	uint32_t elapsed = (now - ProfileStart) * TICK_COUNTS_PER_MS;
+	uint32_t busy;
+
+	IE &= ~IE_ET2__BMASK;
+	busy = IsrTime;
+	*worstCase = (uint16_t)(((uint32_t)IsrWorst * 3) / 5);
+	IsrTime = 0;
+	IsrWorst = 0;
+	IE |= IE_ET2__ENABLED;
+
+	ProfileStart = now;
+
+	if (elapsed == 0) {
+		return 0;
+	}
+
+	return (uint16_t)((busy * 1000) / elapsed);
+}
+#endif
+
+/**
+ * @brief timer 2 interrupt, runs at every edge of the schedule
+ */
+SI_INTERRUPT (TIMER2_ISR, TIMER2_IRQn) {
+	LedPwmSchedule_t xdata *schedule = &Schedule[Active];
+	uint8_t edge = Edge;
+	uint8_t mask = schedule->mask[edge];
+#if LED_PWM_PROFILE
+	SI_UU16_t start;
+
+	start.u8[LSB] = TMR3L;
+	start.u8[MSB] = TMR3H;
+#endif
+
+	TMR2CN0 &= ~TMR2CN0_TF2H__BMASK;
+
+	if (edge == schedule->count - 1) {
+		// Period start, every LED in the mask goes on (pin low) and the
+		// rest off, so a LED set to 0 from fully on doesn't stay lit
+		LED1 = !(mask & (1 << LED_PWM_LED1));
+		LED2 = !(mask & (1 << LED_PWM_LED2));
+		LED3 = !(mask & (1 << LED_PWM_LED3));
+		LED4 = !(mask & (1 << LED_PWM_LED4));
+		LED5 = !(mask & (1 << LED_PWM_LED5));
+	} else {
+		// switch off the LEDs ending at this level
+		if (mask & (1 << LED_PWM_LED1)) {
+			LED1 = 1;
+		}
+		if (mask & (1 << LED_PWM_LED2)) {
+			LED2 = 1;
+		}
+		if (mask & (1 << LED_PWM_LED3)) {
+			LED3 = 1;
+		}
+		if (mask & (1 << LED_PWM_LED4)) {
+			LED4 = 1;
+		}
+		if (mask & (1 << LED_PWM_LED5)) {
+			LED5 = 1;
+		}
+	}
+
+	// The timer has already reloaded for the interval up to the next edge,
+	// so program the reload for the interval after that
+	if (++edge == schedule->count) {
+		edge = 0;
+	}
+
+	if (edge == schedule->count - 1) {
+		// Next edge starts a period, the interval after it belongs to the
+		// new schedule if there is one
+		if (Pending != 0xFF) {
+			Active = Pending;
+			Pending = 0xFF;
+			schedule = &Schedule[Active];
+			edge = schedule->count - 1;
+		}
+
+		TMR2RL = LED_PWM_RELOAD(schedule->steps[0]);
+	} else {
+		TMR2RL = LED_PWM_RELOAD(schedule->steps[edge + 1]);
+	}
+
+	Edge = edge;
+
+#if LED_PWM_PROFILE
+	{
+		SI_UU16_t end;
+		uint16_t time;
+
+		end.u8[LSB] = TMR3L;
+		end.u8[MSB] = TMR3H;
+		time = end.u16 - start.u16;
+
+		if (end.u16 < start.u16) {
+			time -= TMR3RL;
+		}
+
+		time <<= Clock_Shift;
+
+		IsrTime += time;
+
+		if (time > IsrWorst) {
+			IsrWorst = time;
+		}
+	}
+#endif
+}
@@ -10,73 +10,184 @@
 #include "cslib.h"
 // [Generated Includes]$
 
+#if COMM_ENABLE
+#include "comm_routines.h"
+#include "event_output.h"
+#endif
+
 
 /**
  * MUX_VALUE_ARRAY In inc/config/cslib_hwconfig.h should be set to this when updating the configurator
  */
 // #define MUX_VALUE_ARRAY 0x0A, 0x0B, 0x0C, 0x02, 0x01, 0x09, 0x03, 0x06, 0x0D,
 
-
 /**
- * define the LED pins
+ * touch event button that turns every LED off
  */
-SI_SBIT (LED1, SFR_P0, 0);
-SI_SBIT (LED2, SFR_P2, 7);
-SI_SBIT (LED3, SFR_P1, 6);
-SI_SBIT (LED4, SFR_P1, 7);
-SI_SBIT (LED5, SFR_P1, 0);
+#define CLEAR_BUTTON 5
 
 /**
- * @brief main program loop
+ * @brief Turn the button debounce state of the frame into events and play
+ * their LED effects
+ *
+ * Buttons 0 to 4 fade their LED in on a press, breathe it on a double tap
+ * and blink it while held. The last button fades every LED out.
  */
-int main(void) {
-	// Call hardware initialization routine
-	enter_DefaultMode_from_RESET();
-	Tick_Init();
-
-	// enable all interrupts
-	IE |= IE_EA__ENABLED | IE_ET2__ENABLED;
+static void Main_UpdateButtons(void) {
+	TouchEvent_t event;
+	uint8_t led;
+
+	TouchEvent_Update();
+
+	while (TouchEvent_Get(&event)) {
+#if COMM_ENABLE && PROFILER_EVENTS
+		eventButton(event.type, event.button);
+#endif
+#if RECORDER_ENABLE
+		Recorder_Event(event.type, event.button);
+#endif
+
+		if (event.button == CLEAR_BUTTON) {
+			if (event.type == TOUCH_EVENT_PRESS) {
+				for (led = 0; led < LED_PWM_COUNT; led++) {
+					LedAnim_Start(led, LED_ANIM_FADE_OUT);
+				}
+
+				circle_slider_ledOff();
+			}
+			continue;
+		}
 
-	while (1) {
-// $[Generated Run-time code]
-		// -----------------------------------------------------------------------------
-		// If low power features are enabled, this will either put the device into a low
-		// power state until it is time to take another scan, or put the device into a
-		// low-power sleep mode if no touches are active
-		// -----------------------------------------------------------------------------
-		CSLIB_lowPowerUpdate();
-
-		// -----------------------------------------------------------------------------
-		// Performs all scanning and data structure updates
-		// -----------------------------------------------------------------------------
-		CSLIB_update();
+		switch (event.type) {
+			case TOUCH_EVENT_PRESS:
+				LedAnim_Start(event.button, LED_ANIM_FADE_IN);
+				break;
 
-// [Generated Run-time code]$
-		circle_slider_main();
+			case TOUCH_EVENT_DOUBLE_TAP:
+				LedAnim_Start(event.button, LED_ANIM_BREATHE);
+				break;
 
-		if (CSLIB_isSensorDebounceActive(3)) {
-			LED1 = false;
+			case TOUCH_EVENT_HOLD:
+				LedAnim_Start(event.button, LED_ANIM_BLINK);
+				break;
 		}
+	}
+}
 
-		if (CSLIB_isSensorDebounceActive(4)) {
-			LED2 = false;
-		}
+/**
+ * @brief Play a two finger wheel gesture on the LEDs
+ *
+ * A spread fades every LED in and a pinch fades them all out.
+ */
+static void Main_UpdateGesture(void) {
+	uint8_t gesture = circle_slider_getGesture();
+	uint8_t effect;
+	uint8_t led;
 
-		if (CSLIB_isSensorDebounceActive(5)) {
-			LED3 = false;
-		}
+	if (gesture == SLIDER_GESTURE_NONE) {
+		return;
+	}
 
-		if (CSLIB_isSensorDebounceActive(6)) {
-			LED4 = false;
-		}
+#if COMM_ENABLE && PROFILER_EVENTS
+	eventGesture(gesture);
+#endif
 
-		if (CSLIB_isSensorDebounceActive(7)) {
-			LED5 = false;
-		}
+	effect = (gesture == SLIDER_GESTURE_SPREAD) ? LED_ANIM_FADE_IN : LED_ANIM_FADE_OUT;
 
-		if (CSLIB_isSensorDebounceActive(8)) {
-			LED1 = LED2 = LED3 = LED4 = LED5 = true;
-			PCA0CPH0 = 0;
-		}
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		LedAnim_Start(led, effect);
 	}
 }
+
+/**
+ * @brief Run one scheduler task
+ */
+void Scheduler_RunTask(uint8_t task) {
+	switch (task) {
+		case TASK_FRAME:
+			Frame_Begin();
+
+// $[Generated Run-time code]
+			// -----------------------------------------------------------------------------
+			// If low power features are enabled, this will either put the device into a low
+			// power state until it is time to take another scan, or put the device into a
+			// low-power sleep mode if no touches are active
+			// -----------------------------------------------------------------------------
+			CSLIB_lowPowerUpdate();
+
+			// -----------------------------------------------------------------------------
+			// Performs all scanning and data structure updates
+			// -----------------------------------------------------------------------------
+			CSLIB_update();
+
+// [Generated Run-time code]$
+			// the slider maths is the heavy part of the frame
+			Clock_Request(CLOCK_FAST);
+			circle_slider_main();
+			Clock_Release(CLOCK_FAST);
+			Main_UpdateGesture();
+			Main_UpdateButtons();
+
+#if RECORDER_ENABLE
+			Recorder_Update();
+#endif
+
+#if COMM_ENABLE
+#if PROFILER_EVENTS
+			// touch events jump ahead of the queued telemetry, and the
+			// latency of the last one is worked out before a command reads it
+			eventPoll();
+#endif
+			// host commands, their replies and the telemetry of the frame
+			CSLIB_commUpdate();
+#endif
+
+			if (Frame_End(CSLIB_anySensorDebounceActive())) {
+				Scheduler_Every(TASK_FRAME, Frame_GetPeriod(), 0);
+			}
+			break;
+
+		case TASK_SETTINGS:
+			// A committed parameter write saves the peaks along with it.
+			// A save writes the parameters in use, so the peaks wait while
+			// there are uncommitted ones.
+			if (!Param_Save() && !Param_IsChanged()) {
+				circle_slider_savePeaks();
+			}
+			break;
+	}
+}
+
+/**
+ * @brief main program loop
+ */
+int main(void) {
+	bool stored;
+
+	// Call hardware initialization routine
+	enter_DefaultMode_from_RESET();
+	Tick_Init();
+#if RECORDER_ENABLE
+	Recorder_Init();
+#endif
+
+	stored = Settings_Init();
+	Param_Init(stored);
+	circle_slider_init(stored);
+	LedPwm_Init();
+	LedAnim_Init();
+	TouchEvent_Init();
+	Frame_Init();
+#if COMM_ENABLE
+	CSLIB_commInit();
+#endif
+	Clock_Init();
+	Scheduler_Init();
+
+	Scheduler_Every(TASK_FRAME, Frame_GetPeriod(), 0);
+
+	// enable all interrupts
+	IE |= IE_EA__ENABLED;
+
+	Scheduler_Run();
+}
@@ -0,0 +1,327 @@
+/**
+ * @file param.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Registry of the detection parameters that can be tuned over the serial
+ * link. Each one has an id, a type, a range and either one value for the
+ * part or one per channel.
+ *
+ * Param_Set() writes the value cslib and the frame governor work from, so a
+ * change takes effect on the next frame. Param_Commit() queues a save of
+ * the values in use, and Param_Init() puts the saved values back at start
+ * up.
+ */
+#include "main.h"
+#include "cslib_config.h"
+#include "cslib.h"
+#include "hardware_routines.h"
+#include "param.h"
+
+/**
+ * type and range of each parameter, indexed by id
+ */
+static const SI_SEGMENT_VARIABLE(PARAMS[PARAM_COUNT], Param_t, SI_SEG_CODE) = {
+	{PARAM_U16, 1, 1, 0xFFFF},				// PARAM_ACTIVE_DELTA
+	{PARAM_U16, 1, 1, 0xFFFF},				// PARAM_INACTIVE_DELTA
+	{PARAM_U8, 1, 1, 16},					// PARAM_DEBOUNCE
+	{PARAM_U8, 1, 5, 1000 / FRAME_RATE_IDLE},	// PARAM_ACTIVE_PERIOD
+	{PARAM_U8, DEF_NUM_SENSORS, 0, 7},		// PARAM_GAIN
+	{PARAM_U8, DEF_NUM_SENSORS, 0, 5}		// PARAM_ACCUMULATION, 1x to 64x
+};
+
+/**
+ * set by Param_Commit() until Param_Save() has written the record
+ */
+static bool Pending = false;
+
+/**
+ * set by Param_Set() until the values in use are saved, see
+ * Param_IsChanged()
+ */
+static bool Changed = false;
+
+/**
+ * @brief Read the value in use
+ */
+static uint16_t Param_Read(uint8_t id, uint8_t channel) {
+	switch (id) {
+		case PARAM_ACTIVE_DELTA:
+			return CSLIB_activeSensorDelta;
+
+		case PARAM_INACTIVE_DELTA:
+			return CSLIB_inactiveSensorDelta;
+
+		case PARAM_DEBOUNCE:
+			return CSLIB_buttonDebounce;
+
+		case PARAM_ACTIVE_PERIOD:
+			return Frame_GetActivePeriod();
+
+		case PARAM_GAIN:
+			return CSLIB_techSpec[channel].gain;
+
+		default:
+			return CSLIB_techSpec[channel].accumulation;
+	}
+}
+
+/**
+ * @brief Start a channel again from a conversion at its new gain or
+ * accumulation, the baseline and buffers hold values of the old scale
+ */
+static void Param_Reseed(uint8_t channel) {
+	CSLIB_resetSensorStruct_t(channel, convertSensor(channel));
+}
+
+/**
+ * @brief Change the value in use, no checks
+ */
+static void Param_Write(uint8_t id, uint8_t channel, uint16_t value) {
+	switch (id) {
+		case PARAM_ACTIVE_DELTA:
+			CSLIB_activeSensorDelta = value;
+			break;
+
+		case PARAM_INACTIVE_DELTA:
+			CSLIB_inactiveSensorDelta = value;
+			break;
+
+		case PARAM_DEBOUNCE:
+			CSLIB_buttonDebounce = (uint8_t)value;
+			break;
+
+		case PARAM_ACTIVE_PERIOD:
+			Frame_SetActivePeriod((uint8_t)value);
+			break;
+
+		case PARAM_GAIN:
+			if (CSLIB_techSpec[channel].gain != (uint8_t)value) {
+				CSLIB_techSpec[channel].gain = (uint8_t)value;
+				Param_Reseed(channel);
+			}
+			break;
+
+		case PARAM_ACCUMULATION:
+			if (CSLIB_techSpec[channel].accumulation != (uint8_t)value) {
+				CSLIB_techSpec[channel].accumulation = (uint8_t)value;
+				Param_Reseed(channel);
+			}
+			break;
+	}
+}
+
+/**
+ * @brief Return where the stored settings record keeps a value
+ */
+static uint8_t code *Param_Stored(uint8_t id, uint8_t channel) {
+	switch (id) {
+		case PARAM_ACTIVE_DELTA:
+			return (uint8_t code *)&SETTINGS_STORED->activeDelta;
+
+		case PARAM_INACTIVE_DELTA:
+			return (uint8_t code *)&SETTINGS_STORED->inactiveDelta;
+
+		case PARAM_DEBOUNCE:
+			return &SETTINGS_STORED->debounce;
+
+		case PARAM_ACTIVE_PERIOD:
+			return &SETTINGS_STORED->activePeriod;
+
+		case PARAM_GAIN:
+			return &SETTINGS_STORED->gain[channel];
+
+		default:
+			return &SETTINGS_STORED->accumulation[channel];
+	}
+}
+
+/**
+ * @brief Put the saved values in use
+ *
+ * @param stored what Settings_Init() returned, the firmware defaults stay
+ * in use when false
+ *
+ * @note call after Settings_Init() and the cslib start up, which sets the
+ * defaults
+ */
+void Param_Init(bool stored) {
+	uint8_t code *record;
+	uint8_t id;
+	uint8_t channel;
+
+	if (!stored) {
+		return;
+	}
+
+	for (id = 0; id < PARAM_COUNT; id++) {
+		for (channel = 0; channel < PARAMS[id].channels; channel++) {
+			record = Param_Stored(id, channel);
+
+			if (PARAMS[id].type == PARAM_U16) {
+				Param_Write(id, channel, *(uint16_t code *)record);
+			} else {
+				Param_Write(id, channel, *record);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Write the values in use into the new settings record
+ *
+ * @note called by Settings_Save()
+ */
+void Param_Store(void) {
+	uint8_t code *record;
+	SI_UU16_t value;
+	uint8_t id;
+	uint8_t channel;
+
+	for (id = 0; id < PARAM_COUNT; id++) {
+		for (channel = 0; channel < PARAMS[id].channels; channel++) {
+			record = Param_Stored(id, channel);
+			value.u16 = Param_Read(id, channel);
+
+			if (PARAMS[id].type == PARAM_U16) {
+				// in memory order, as Param_Init() reads it back
+				Settings_Put(record, value.u8[0]);
+				Settings_Put(record + 1, value.u8[1]);
+			} else {
+				Settings_Put(record, value.u8[LSB]);
+			}
+		}
+	}
+
+	Changed = false;
+}
+
+/**
+ * @brief Read a parameter
+ *
+ * @param id PARAM_ACTIVE_DELTA to PARAM_ACCUMULATION
+ * @param channel sensor index for the per channel ones, 0 for the others
+ * @param value where to put the value
+ *
+ * @return PARAM_OK or PARAM_BAD_ID
+ */
+uint8_t Param_Get(uint8_t id, uint8_t channel, uint16_t *value) {
+	if (id >= PARAM_COUNT || channel >= PARAMS[id].channels) {
+		return PARAM_BAD_ID;
+	}
+
+	*value = Param_Read(id, channel);
+
+	return PARAM_OK;
+}
+
+/**
+ * @brief Change a parameter, it is used from the next frame on
+ *
+ * @param id PARAM_ACTIVE_DELTA to PARAM_ACCUMULATION
+ * @param channel sensor index for the per channel ones, 0 for the others
+ * @param value the new value
+ *
+ * @return PARAM_OK, PARAM_BAD_ID or PARAM_BAD_VALUE
+ *
+ * @note the inactive delta may not go above the active delta, cslib needs
+ * the gap between the two for its hysteresis
+ *
+ * @note a new gain or accumulation runs one conversion of the channel to
+ * start its baseline again, a touch held on it at the time is lost
+ */
+uint8_t Param_Set(uint8_t id, uint8_t channel, uint16_t value) {
+	if (id >= PARAM_COUNT || channel >= PARAMS[id].channels) {
+		return PARAM_BAD_ID;
+	}
+
+	if (value < PARAMS[id].min || value > PARAMS[id].max) {
+		return PARAM_BAD_VALUE;
+	}
+
+	if ((id == PARAM_ACTIVE_DELTA && value < CSLIB_inactiveSensorDelta) ||
+		(id == PARAM_INACTIVE_DELTA && value > CSLIB_activeSensorDelta)) {
+		return PARAM_BAD_VALUE;
+	}
+
+	Param_Write(id, channel, value);
+	Changed = true;
+
+	return PARAM_OK;
+}
+
+/**
+ * @brief Read the type, channel count or range of a parameter
+ *
+ * @param id PARAM_ACTIVE_DELTA to PARAM_ACCUMULATION
+ * @param item PARAM_INFO_TYPE, PARAM_INFO_CHANNELS, PARAM_INFO_MIN or
+ * PARAM_INFO_MAX
+ * @param value where to put the answer
+ *
+ * @return PARAM_OK or PARAM_BAD_ID
+ */
+uint8_t Param_Describe(uint8_t id, uint8_t item, uint16_t *value) {
+	if (id >= PARAM_COUNT) {
+		return PARAM_BAD_ID;
+	}
+
+	switch (item) {
+		case PARAM_INFO_TYPE:
+			*value = PARAMS[id].type;
+			break;
+
+		case PARAM_INFO_CHANNELS:
+			*value = PARAMS[id].channels;
+			break;
+
+		case PARAM_INFO_MIN:
+			*value = PARAMS[id].min;
+			break;
+
+		case PARAM_INFO_MAX:
+			*value = PARAMS[id].max;
+			break;
+
+		default:
+			return PARAM_BAD_ID;
+	}
+
+	return PARAM_OK;
+}
+
+/**
+ * @brief Queue the settings task to write the values in use
+ *
+ * @note a value set before the write runs, PARAM_SAVE_DELAY later, is
+ * saved along with the rest
+ */
+void Param_Commit(void) {
+	Pending = true;
+	Scheduler_Once(TASK_SETTINGS, PARAM_SAVE_DELAY);
+}
+
+/**
+ * @brief Write the settings record if Param_Commit() asked for it
+ *
+ * @return true if the record was written
+ */
+bool Param_Save(void) {
+	if (!Pending) {
+		return false;
+	}
+
+	Pending = false;
+	Settings_Save();
+
+	return true;
+}
+
+/**
+ * @brief Check for values set since the last save
+ *
+ * @return true while the values in use differ from the stored record, a
+ * save for any other reason would commit them
+ */
+bool Param_IsChanged(void) {
+	return Changed;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file power.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Power state residency. The up time is split between active, IDLE (core
+ * stopped between frames), suspend (core stopped while CS0 converts) and
+ * RTC sleep. The low power layer reports suspend and sleep from its RTC
+ * time stamps, Tick_Idle() counts the idle time for Power_Update() to
+ * collect and what is left of the Tick_GetMicros() time at each
+ * Power_Update() was active. Weighted by the
+ * typical current of each state this gives the average current and a
+ * battery life estimate.
+ *
+ * The times are kept in microseconds and all halved together before any
+ * of them gets near 32 bits, so the shares stay right over any up time.
+ */
+#include "main.h"
+#include "power.h"
+
+#if POWER_STATS_ENABLE
+
+#if !COMM_ENABLE
+#error "The power statistics are read through the serial interface"
+#endif
+
+/**
+ * time spent in each state in microseconds, see the file comment
+ */
+static SI_SEGMENT_VARIABLE(Residency[POWER_STATE_COUNT], uint32_t, SI_SEG_XDATA);
+
+/**
+ * idle and sleep time reported since the last Power_Update(), both are
+ * part of the Tick_GetMicros() time
+ */
+static uint32_t Accounted = 0;
+
+/**
+ * Tick_GetMicros() at the last Power_Update()
+ */
+static uint32_t LastUpdate = 0;
+
+/**
+ * typical supply current of each state in uA
+ */
+static const SI_SEGMENT_VARIABLE(CURRENT[POWER_STATE_COUNT], uint16_t, SI_SEG_CODE) = {
+	POWER_CURRENT_ACTIVE,
+	POWER_CURRENT_IDLE,
+	POWER_CURRENT_SUSPEND,
+	POWER_CURRENT_SLEEP
+};
+
+/**
+ * @brief Return the sum of all the residency times
+ */
+static uint32_t Power_Total(void) {
+	uint32_t total = 0;
+	uint8_t state;
+
+	for (state = 0; state < POWER_STATE_COUNT; state++) {
+		total += Residency[state];
+	}
+
+	return total;
+}
+
+/**
+ * @brief Add time spent in a power state
+ * @param state POWER_ACTIVE, POWER_IDLE, POWER_SUSPEND or POWER_SLEEP
+ * @param micros time in microseconds
+ */
+void Power_Account(uint8_t state, uint32_t micros) {
+	uint8_t index;
+
+	Residency[state] += micros;
+
+	if (state == POWER_IDLE || state == POWER_SLEEP) {
+		Accounted += micros;
+	}
+
+	// keeping each under 2^30 keeps the total in 32 bits
+	if (Residency[state] & 0xC0000000UL) {
+		for (index = 0; index < POWER_STATE_COUNT; index++) {
+			Residency[index] >>= 1;
+		}
+	}
+}
+
+/**
+ * @brief Book the time since the last call that wasn't idle or sleep as
+ * active. Called once a frame by the low power layer.
+ */
+void Power_Update(void) {
+	uint32_t now = Tick_GetMicros();
+	uint32_t elapsed = now - LastUpdate;
+
+	LastUpdate = now;
+
+	Power_Account(POWER_IDLE, Tick_TakeIdleMicros());
+
+	if (elapsed > Accounted) {
+		Power_Account(POWER_ACTIVE, elapsed - Accounted);
+	}
+
+	Accounted = 0;
+}
+
+/**
+ * @brief Return the share of the time spent in a power state
+ * @param state POWER_ACTIVE, POWER_IDLE, POWER_SUSPEND or POWER_SLEEP
+ * @return per-mille of the time since Power_ClearStats()
+ */
+uint16_t Power_GetShare(uint8_t state) {
+	uint32_t total = Power_Total();
+
+	if (total < 1000) {
+		return 0;
+	}
+
+	return (uint16_t)(Residency[state] / (total / 1000));
+}
+
+/**
+ * @brief Return the estimated average supply current in uA
+ */
+uint16_t Power_GetAverageCurrent(void) {
+	uint32_t total = Power_Total();
+	uint32_t charge = 0;
+	uint8_t shift = 0;
+	uint8_t state;
+
+	// with 20 bits of time the weighted sum fits in 32 bits
+	while ((total >> shift) > 0xFFFFF) {
+		shift++;
+	}
+
+	total >>= shift;
+	if (!total) {
+		return 0;
+	}
+
+	for (state = 0; state < POWER_STATE_COUNT; state++) {
+		charge += (Residency[state] >> shift) * CURRENT[state];
+	}
+
+	return (uint16_t)(charge / total);
+}
+
+/**
+ * @brief Return the estimated battery life at the average current
+ * @return hours, 0 if nothing has been measured yet
+ */
+uint32_t Power_GetBatteryHours(void) {
+	uint16_t current = Power_GetAverageCurrent();
+
+	if (!current) {
+		return 0;
+	}
+
+	return POWER_BATTERY_UAH / current;
+}
+
+/**
+ * @brief Restart the residency figures
+ */
+void Power_ClearStats(void) {
+	uint8_t state;
+
+	for (state = 0; state < POWER_STATE_COUNT; state++) {
+		Residency[state] = 0;
+	}
+
+	Accounted = 0;
+	LastUpdate = Tick_GetMicros();
+
+	Tick_TakeIdleMicros();
+}
+
+#endif
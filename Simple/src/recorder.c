@@ -0,0 +1,203 @@
+/**
+ * @file recorder.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Flight recorder. Once a frame the debounce state and the touch delta of
+ * every sensor are packed into a ring of the last RECORDER_FRAMES frames,
+ * next to a ring of the last RECORDER_EVENTS touch events, so a misbehaving
+ * unit can be looked at without streaming all the time.
+ *
+ * A trigger freezes both rings: a false touch (a debounced touch that only
+ * lasted a few frames), or the host reporting a missed touch or asking for
+ * a dump. The rings live in XRAM the startup code doesn't clear, so a
+ * recording frozen before a reset other than a power on reset survives it.
+ * There is no watchdog trigger: the watchdog is PCA module 2 and enabling
+ * it locks PCA0MD, which the wheel LED PWM needs to change at run time.
+ * The host reads it with the commands of command_interface.c and re-arms
+ * it when done.
+ */
+#include "main.h"
+#include "cslib_config.h"
+#include "cslib.h"
+#include "recorder.h"
+
+#if RECORDER_ENABLE
+
+#if !COMM_ENABLE
+#error "The recorder is read through the serial interface"
+#endif
+
+/**
+ * the recording, deliberately left out of any initialisation
+ */
+SI_SEGMENT_VARIABLE(Recorder, Recorder_t, SI_SEG_XDATA);
+
+/**
+ * @brief Return a recorded frame
+ * @param age 0 for the last frame recorded, 1 for the one before...
+ */
+static RecorderFrame_t xdata *Recorder_Back(uint8_t age) {
+	return &Recorder.frame[(uint8_t)(Recorder.frameHead - 1 - age) & (RECORDER_FRAMES - 1)];
+}
+
+/**
+ * @brief Tell if a sensor released in the last frame had only been down
+ * for RECORDER_GLITCH_FRAMES frames or less
+ * @param released debounce bits that went off in the last frame
+ */
+static bool Recorder_FalseTouch(uint16_t released) {
+	uint8_t age;
+
+	// the press has to be in the ring too
+	if (Recorder_GetFrameCount() < RECORDER_GLITCH_FRAMES + 2) {
+		return false;
+	}
+
+	for (age = 2; age <= RECORDER_GLITCH_FRAMES + 1; age++) {
+		if (released & ~Recorder_Back(age)->debounce) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Keep a recording frozen before the reset, start a new one
+ * otherwise. Called once at start up.
+ */
+void Recorder_Init(void) {
+	uint8_t reset = RSTSRC;
+
+	// XRAM is random after a power on reset
+	if (Recorder.magic == RECORDER_MAGIC && !(reset & RSTSRC_PORSF__BMASK)
+			&& Recorder.trigger != RECORDER_TRIGGER_NONE) {
+		return;
+	}
+
+	Recorder_Arm();
+}
+
+/**
+ * @brief Record the frame just scanned and look for a false touch. Called
+ * once a frame after CSLIB_update().
+ */
+void Recorder_Update(void) {
+	RecorderFrame_t xdata *frame;
+	uint16_t debounce = 0;
+	uint16_t baseline;
+	uint16_t process;
+	uint8_t index;
+
+	if (Recorder.trigger != RECORDER_TRIGGER_NONE) {
+		return;
+	}
+
+	frame = &Recorder.frame[Recorder.frameHead & (RECORDER_FRAMES - 1)];
+	frame->sequence = (uint8_t)Frame_GetSequence();
+
+	for (index = 0; index < DEF_NUM_SENSORS; index++) {
+		if (CSLIB_node[index].activeIndicator & DEBOUNCE_ACTIVE_MASK) {
+			debounce |= (1 << index);
+		}
+
+		baseline = CSLIB_node[index].currentBaseline;
+		process = CSLIB_nodeGetProcess(index, 0);
+		Recorder.baseline[index] = baseline;
+
+		if (process <= baseline) {
+			frame->delta[index] = 0;
+		} else if ((process - baseline) >> RECORDER_SHIFT > 0xFF) {
+			frame->delta[index] = 0xFF;
+		} else {
+			frame->delta[index] = (process - baseline) >> RECORDER_SHIFT;
+		}
+	}
+
+	frame->debounce = debounce;
+
+	// a multiple of RECORDER_FRAMES, so the slots stay in place and
+	// Recorder_GetFrameCount() stays right when the head wraps
+	if (++Recorder.frameHead == 0) {
+		Recorder.frameHead = RECORDER_FRAMES;
+	}
+
+	if (Recorder_FalseTouch(Recorder_Back(1)->debounce & ~debounce)) {
+		Recorder_Trigger(RECORDER_TRIGGER_FALSE_TOUCH);
+	}
+}
+
+/**
+ * @brief Record a touch event
+ * @param type TOUCH_EVENT_ type
+ * @param source button
+ */
+void Recorder_Event(uint8_t type, uint8_t source) {
+	RecorderEvent_t xdata *event;
+
+	if (Recorder.trigger != RECORDER_TRIGGER_NONE) {
+		return;
+	}
+
+	event = &Recorder.event[Recorder.eventHead & (RECORDER_EVENTS - 1)];
+	event->sequence = (uint8_t)Frame_GetSequence();
+	event->type = type;
+	event->source = source;
+
+	if (++Recorder.eventHead == 0) {
+		Recorder.eventHead = RECORDER_EVENTS;
+	}
+}
+
+/**
+ * @brief Freeze the recording, unless it already is
+ * @param trigger RECORDER_TRIGGER_ reason reported with the dump
+ */
+void Recorder_Trigger(uint8_t trigger) {
+	if (Recorder.trigger == RECORDER_TRIGGER_NONE) {
+		Recorder.trigger = trigger;
+	}
+}
+
+/**
+ * @brief Drop the recording and start a new one
+ */
+void Recorder_Arm(void) {
+	Recorder.magic = RECORDER_MAGIC;
+	Recorder.trigger = RECORDER_TRIGGER_NONE;
+	Recorder.frameHead = 0;
+	Recorder.eventHead = 0;
+}
+
+/**
+ * @brief Return the number of frames held, RECORDER_FRAMES at most
+ */
+uint8_t Recorder_GetFrameCount(void) {
+	return (Recorder.frameHead < RECORDER_FRAMES) ? Recorder.frameHead : RECORDER_FRAMES;
+}
+
+/**
+ * @brief Return a frame held
+ * @param index 0 for the oldest, up to Recorder_GetFrameCount() - 1
+ */
+RecorderFrame_t xdata *Recorder_GetFrame(uint8_t index) {
+	return Recorder_Back(Recorder_GetFrameCount() - 1 - index);
+}
+
+/**
+ * @brief Return the number of events held, RECORDER_EVENTS at most
+ */
+uint8_t Recorder_GetEventCount(void) {
+	return (Recorder.eventHead < RECORDER_EVENTS) ? Recorder.eventHead : RECORDER_EVENTS;
+}
+
+/**
+ * @brief Return an event held
+ * @param index 0 for the oldest, up to Recorder_GetEventCount() - 1
+ */
+RecorderEvent_t xdata *Recorder_GetEvent(uint8_t index) {
+	return &Recorder.event[(uint8_t)(Recorder.eventHead - Recorder_GetEventCount() + index) & (RECORDER_EVENTS - 1)];
+}
+
+#endif
@@ -0,0 +1,296 @@
+/**
+ * @file scheduler.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Cooperative scheduler on top of the 1ms tick.
+ *
+ * Waiting tasks sit in a hashed timer wheel, in the slot for their due
+ * time modulo SCHEDULER_WHEEL_SIZE. Each tick only the slot for that
+ * millisecond is checked, and the tasks in it whose due time has come move
+ * to the ready mask. Ready tasks run one at a time, lowest ID first, and
+ * the core idles until the next interrupt when nothing is ready.
+ *
+ * Tasks are dispatched through Scheduler_RunTask() rather than function
+ * pointers so the compiler can still overlay their locals.
+ */
+#include "main.h"
+#include "scheduler.h"
+
+typedef struct {
+	uint16_t due;			// tick the task runs on, low 16 bits
+	uint16_t period;		// 0 for a one shot task
+	uint8_t deadline;		// ms late a run may start, 0 for none
+	uint8_t missed;			// runs started late or skipped
+} SchedulerTask_t;
+
+/**
+ * The scheduler state is a few bytes touched on every pass of the loop, it
+ * stays in internal RAM and leaves the XRAM to cslib
+ */
+static SI_SEGMENT_VARIABLE(Task[SCHEDULER_TASK_COUNT], SchedulerTask_t, SI_SEG_IDATA);
+
+/**
+ * a bit per task waiting in each wheel slot
+ */
+static SI_SEGMENT_VARIABLE(Wheel[SCHEDULER_WHEEL_SIZE], uint8_t, SI_SEG_IDATA);
+
+/**
+ * a bit per task that is due to run
+ */
+static uint8_t Ready = 0;
+
+/**
+ * last tick the wheel was turned to
+ */
+static uint16_t Now = 0;
+
+#if COMM_ENABLE
+/**
+ * us each task spent running, not counting sleep and conversion suspend,
+ * and Tick_GetMicros() when the load figures were cleared. Only read over
+ * serial.
+ */
+static SI_SEGMENT_VARIABLE(Busy[SCHEDULER_TASK_COUNT], uint32_t, SI_SEG_XDATA);
+static uint32_t LoadStart = 0;
+#endif
+
+/**
+ * @brief Put a task in the wheel, or straight in the ready mask if its due
+ * time has passed
+ */
+static void Scheduler_Insert(uint8_t task, uint16_t due) {
+	Task[task].due = due;
+
+	if ((int16_t)(due - Now) <= 0) {
+		Ready |= 1 << task;
+	} else {
+		Wheel[due & (SCHEDULER_WHEEL_SIZE - 1)] |= 1 << task;
+	}
+}
+
+/**
+ * @brief Take a task out of the wheel and the ready mask
+ */
+static void Scheduler_Remove(uint8_t task) {
+	Wheel[Task[task].due & (SCHEDULER_WHEEL_SIZE - 1)] &= ~(1 << task);
+	Ready &= ~(1 << task);
+}
+
+/**
+ * @brief Turn the wheel up to the current tick
+ */
+static void Scheduler_Advance(void) {
+	uint16_t ticks = (uint16_t)Tick_GetCount();
+	uint8_t slot;
+	uint8_t waiting;
+	uint8_t task;
+
+	while (Now != ticks) {
+		Now++;
+		slot = Now & (SCHEDULER_WHEEL_SIZE - 1);
+		waiting = Wheel[slot];
+
+		for (task = 0; waiting; task++, waiting >>= 1) {
+			if ((waiting & 1) && Task[task].due == Now) {
+				Wheel[slot] &= ~(1 << task);
+				Ready |= 1 << task;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Return the milliseconds until the next task is due
+ *
+ * @return 0 if a task is ready, TICK_NO_LIMIT if nothing is waiting
+ */
+static uint16_t Scheduler_NextDue(void) {
+	uint16_t next = TICK_NO_LIMIT;
+	uint16_t left;
+	uint8_t waiting = 0;
+	uint8_t task;
+
+	if (Ready) {
+		return 0;
+	}
+
+	for (task = 0; task < SCHEDULER_WHEEL_SIZE; task++) {
+		waiting |= Wheel[task];
+	}
+
+	for (task = 0; waiting; task++, waiting >>= 1) {
+		if (waiting & 1) {
+			left = Task[task].due - Now;
+
+			if (left < next) {
+				next = left;
+			}
+		}
+	}
+
+	return next;
+}
+
+/**
+ * @brief Start the scheduler with no task pending
+ */
+void Scheduler_Init(void) {
+	uint8_t index;
+
+	for (index = 0; index < SCHEDULER_TASK_COUNT; index++) {
+		Task[index].due = 0;
+		Task[index].period = 0;
+		Task[index].deadline = 0;
+		Task[index].missed = 0;
+	}
+
+	for (index = 0; index < SCHEDULER_WHEEL_SIZE; index++) {
+		Wheel[index] = 0;
+	}
+
+	Ready = 0;
+	Now = (uint16_t)Tick_GetCount();
+#if COMM_ENABLE
+	Scheduler_ClearLoad();
+#endif
+}
+
+/**
+ * @brief Run a task every period milliseconds, starting one period from now
+ *
+ * @param task task ID
+ * @param period time between runs in ms
+ * @param deadline ms a run may start late before it counts as missed, 0 to
+ * only count skipped runs
+ */
+void Scheduler_Every(uint8_t task, uint16_t period, uint8_t deadline) {
+	Scheduler_Remove(task);
+	Task[task].period = period;
+	Task[task].deadline = deadline;
+	Scheduler_Insert(task, Now + period);
+}
+
+/**
+ * @brief Run a task once after delay milliseconds
+ *
+ * @note a task that is already waiting is moved to the new time, so calling
+ * this again pushes the run back
+ */
+void Scheduler_Once(uint8_t task, uint16_t delay) {
+	Scheduler_Remove(task);
+	Task[task].period = 0;
+	Task[task].deadline = 0;
+	Scheduler_Insert(task, Now + delay);
+}
+
+/**
+ * @brief Cancel a task
+ */
+void Scheduler_Stop(uint8_t task) {
+	Scheduler_Remove(task);
+	Task[task].period = 0;
+}
+
+/**
+ * @brief Run the tasks as they come due, never returns
+ */
+void Scheduler_Run(void) {
+	SchedulerTask_t idata *entry;
+#if COMM_ENABLE
+	uint32_t start;
+	uint32_t stopped;
+#endif
+	uint16_t due;
+	uint8_t task;
+
+	while (1) {
+		// the LED effects change levels in the tick interrupt and leave
+		// the PWM schedule to be built here
+		LedPwm_Update();
+
+		Scheduler_Advance();
+
+		if (!Ready) {
+			// wake on the next interrupt, the tick at the latest
+			Tick_Idle();
+			continue;
+		}
+
+		for (task = 0; !(Ready & (1 << task)); task++);
+
+		Ready &= ~(1 << task);
+		entry = &Task[task];
+
+		if (entry->deadline && (uint16_t)(Now - entry->due) > entry->deadline && entry->missed < 0xFF) {
+			entry->missed++;
+		}
+
+		// Reschedule before running so the task can stop or move itself.
+		// Keep the rate rather than drift, skipping any runs already lost.
+		if (entry->period) {
+			due = entry->due + entry->period;
+
+			while ((int16_t)(due - Now) <= 0) {
+				due += entry->period;
+
+				if (entry->missed < 0xFF) {
+					entry->missed++;
+				}
+			}
+
+			Scheduler_Insert(task, due);
+		}
+
+		// the scan may put the core to sleep, it must not sleep past the
+		// next task
+		Tick_SetSleepLimit(Scheduler_NextDue());
+
+#if COMM_ENABLE
+		start = Tick_GetMicros();
+		stopped = Tick_GetStoppedMicros();
+		Scheduler_RunTask(task);
+		Busy[task] += (Tick_GetMicros() - start) - (Tick_GetStoppedMicros() - stopped);
+#else
+		Scheduler_RunTask(task);
+#endif
+	}
+}
+
+/**
+ * @brief Return the number of late or skipped runs of a task
+ */
+uint8_t Scheduler_GetMissed(uint8_t task) {
+	return Task[task].missed;
+}
+
+#if COMM_ENABLE
+/**
+ * @brief Return the CPU time a task used since Scheduler_ClearLoad()
+ *
+ * @return parts per thousand
+ */
+uint16_t Scheduler_GetLoad(uint8_t task) {
+	uint32_t elapsed = Tick_GetMicros() - LoadStart;
+
+	if (elapsed < 1000) {
+		return 0;
+	}
+
+	return (uint16_t)(Busy[task] / (elapsed / 1000));
+}
+
+/**
+ * @brief Restart the load measurement and the missed run counts
+ */
+void Scheduler_ClearLoad(void) {
+	uint8_t index;
+
+	for (index = 0; index < SCHEDULER_TASK_COUNT; index++) {
+		Busy[index] = 0;
+		Task[index].missed = 0;
+	}
+
+	LoadStart = Tick_GetMicros();
+}
+#endif
@@ -0,0 +1,109 @@
+/**
+ * @file settings.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Keeps a small settings record in a dedicated flash page. There is no RAM
+ * copy: the values in use live in the modules that own them, which read
+ * the stored record in place at start up through SETTINGS_STORED and hand
+ * their values back a byte at a time with Settings_Put() when
+ * Settings_Save() rewrites the page.
+ */
+#include "main.h"
+#include "settings.h"
+
+/**
+ * loop count of the VDD monitor settle time, at least 100us at the full clock
+ */
+#define SETTINGS_VDM_DELAY	600
+
+/**
+ * byte sum of the record written so far by Settings_Save()
+ */
+static uint8_t Sum = 0;
+
+/**
+ * @brief Write one byte to flash
+ *
+ * @param address flash address to write
+ * @param value the byte to write
+ *
+ * @note PSEE must already be set when this is used to erase a page
+ */
+static void Settings_WriteByte(uint16_t address, uint8_t value) {
+	uint8_t xdata *destination = (uint8_t xdata *)address;
+
+	FLKEY = 0xA5;
+	FLKEY = 0xF1;
+
+	PSCTL |= PSCTL_PSWE__WRITE_ENABLED;
+	*destination = value;
+	PSCTL &= ~(PSCTL_PSEE__ERASE_ENABLED | PSCTL_PSWE__WRITE_ENABLED);
+}
+
+/**
+ * @brief Check the record stored in flash
+ *
+ * @return true if SETTINGS_STORED holds a valid record, false if the
+ * owners of the values should keep their firmware defaults
+ */
+bool Settings_Init(void) {
+	uint8_t index;
+	uint8_t sum = 0;
+	uint8_t code *stored = (uint8_t code *)SETTINGS_STORED;
+
+	for (index = 0; index < sizeof(Settings_t); index++) {
+		sum += stored[index];
+	}
+
+	return sum == 0 && SETTINGS_STORED->version == SETTINGS_VERSION;
+}
+
+/**
+ * @brief Write one byte of the new record
+ *
+ * @param field address of the byte in SETTINGS_STORED
+ * @param value the byte to write
+ *
+ * @note only valid while Settings_Save() runs, every byte of the record but
+ * the version and checksum must be written exactly once
+ */
+void Settings_Put(uint8_t code *field, uint8_t value) {
+	Settings_WriteByte((uint16_t)field, value);
+	Sum += value;
+}
+
+/**
+ * @brief Erase the settings page and write the values in use to it
+ *
+ * @note this function is blocking and runs with interrupts disabled for the
+ * page erase, so only call it when nothing time critical is in progress.
+ */
+void Settings_Save(void) {
+	uint16_t delay;
+	bit interruptsEnabled = IE_EA;
+
+	// MOVX writes go to flash while PSWE is set, so no ISR may run
+	IE_EA = 0;
+
+	// Flash writes require the VDD monitor to be a reset source, and it has
+	// to settle once enabled or selecting it can reset the part
+	if (!(VDM0CN & VDM0CN_VDMEN__BMASK)) {
+		VDM0CN |= VDM0CN_VDMEN__ENABLED;
+
+		for (delay = SETTINGS_VDM_DELAY >> Clock_Shift; delay > 0; delay--) {
+		}
+	}
+	RSTSRC = RSTSRC_PORSF__SET;
+
+	PSCTL |= PSCTL_PSEE__ERASE_ENABLED;
+	Settings_WriteByte(SETTINGS_FLASH_ADDRESS, 0);
+
+	Sum = 0;
+	Settings_Put(&SETTINGS_STORED->version, SETTINGS_VERSION);
+	Param_Store();
+	circle_slider_storePeaks();
+	Settings_WriteByte((uint16_t)&SETTINGS_STORED->checksum, (uint8_t)(0 - Sum));
+
+	IE_EA = interruptsEnabled;
+}
@@ -8,25 +8,191 @@
 /**
  * holds the current tick valus since the micro powered up
  */
-static uint16_t Ticks = 0;
+static volatile uint32_t Ticks = 0;
+
+/**
+ * SYSCLK divider shift Timer 3 is set up for, see Tick_SetClockShift()
+ */
+static uint8_t Shift = 0;
+
+/**
+ * @brief Timer 3 reload value for the current SYSCLK
+ */
+#define TICK_CURRENT_RELOAD ((uint16_t)(0 - (TICK_COUNTS_PER_MS >> Shift)))
+
+/**
+ * tick by which the core must be awake again, see Tick_SetSleepLimit()
+ */
+static uint32_t SleepDeadline = 0;
+static bool SleepLimited = false;
+
+/**
+ * microseconds of conversion suspend not yet added to the tick, see
+ * Tick_AddSuspend()
+ */
+static uint16_t SuspendCarry = 0;
+
+/**
+ * microseconds spent asleep, see Tick_GetSleptMicros()
+ */
+static uint32_t Slept = 0;
+
+#if COMM_ENABLE
+/**
+ * microseconds suspended for conversions, see Tick_GetStoppedMicros()
+ */
+static uint32_t Suspended = 0;
+#endif
+
+#if POWER_STATS_ENABLE
+/**
+ * full speed Timer 3 counts spent in Tick_Idle() since the last
+ * Tick_TakeIdleMicros()
+ */
+static uint32_t IdleCounts = 0;
+#endif
 
 /**
  * @brief Return the system up time in millisecond
  *
- * @return  Number of milliseconds since system start.
+ * The 8051 copies the counter a byte at a time, so the tick interrupt can
+ * land in the middle of a read. Rather than masking it, the counter is
+ * read until two copies in a row match. The interrupt only fires once a
+ * millisecond, so two matching copies can't both be torn.
+ *
+ * @return  Number of milliseconds since system start, wraps after 49 days.
  */
-static uint16_t Tick_GetCount(void) {
-    uint16_t ticks;
+uint32_t Tick_GetCount(void) {
+	uint32_t ticks;
 
-    // Disable Timer 3 interrupts
-    EIE1 &= ~EIE1_ET3__BMASK;
+	do {
+		ticks = Ticks;
+	} while (ticks != Ticks);
 
-    ticks = Ticks;
+	return ticks;
+}
 
-    // Enable Timer 3 interrupts
-    EIE1 |= EIE1_ET3__BMASK;
+/**
+ * @brief Return the milliseconds passed since a Tick_GetCount() value
+ *
+ * @note correct across the counter wrap
+ */
+uint32_t Tick_Elapsed(uint32_t since) {
+	return Tick_GetCount() - since;
+}
 
-    return ticks;
+/**
+ * @brief Check if a deadline has been reached
+ *
+ * @param deadline Tick_GetCount() value to wait for
+ *
+ * @return true once the deadline is now or in the past. Correct across
+ * the counter wrap for deadlines less than 24 days away.
+ */
+bool Tick_IsDue(uint32_t deadline) {
+	return (int32_t)(Tick_GetCount() - deadline) >= 0;
+}
+
+/**
+ * @brief Return the system up time in microseconds
+ *
+ * The milliseconds come from the tick counter and the fraction from the
+ * live Timer 3 count, which runs at SYSCLK / 12 (0.6us per count at the
+ * fast clock).
+ *
+ * @return  Number of microseconds since system start, wraps after 71 minutes.
+ */
+uint32_t Tick_GetMicros(void) {
+	uint32_t ticks;
+	SI_UU16_t count;
+	bool overflow;
+
+	do {
+		ticks = Tick_GetCount();
+
+		// the high byte can move on while the low byte is read
+		do {
+			count.u8[MSB] = TMR3H;
+			count.u8[LSB] = TMR3L;
+		} while (count.u8[MSB] != TMR3H);
+
+		overflow = (TMR3CN0 & TMR3CN0_TF3H__BMASK) != 0;
+	} while (ticks != Ticks);
+
+	// in full speed counts from the start of the millisecond
+	count.u16 = (count.u16 - TICK_CURRENT_RELOAD) << Shift;
+
+	// Timer 3 overflowed but the interrupt hasn't counted it yet, either
+	// interrupts are off or it is waiting behind the caller. A count near the
+	// top means the overflow came after the count was read.
+	if (overflow && count.u16 < (TICK_COUNTS_PER_MS / 2)) {
+		ticks++;
+	}
+
+	return (ticks * 1000) + ((count.u16 * 3) / 5);
+}
+
+#if POWER_STATS_ENABLE
+/**
+ * @brief Read the low byte of the tick counter and the Timer 3 count from
+ * the start of that millisecond, in counts of the current clock
+ */
+static uint16_t Tick_ReadCount(uint8_t *ticks) {
+	SI_UU16_t count;
+
+	do {
+		*ticks = (uint8_t)Ticks;
+
+		do {
+			count.u8[MSB] = TMR3H;
+			count.u8[LSB] = TMR3L;
+		} while (count.u8[MSB] != TMR3H);
+	} while (*ticks != (uint8_t)Ticks);
+
+	return count.u16 - TICK_CURRENT_RELOAD;
+}
+
+/**
+ * @brief Return the time spent in Tick_Idle() since the last call in
+ * microseconds
+ */
+uint32_t Tick_TakeIdleMicros(void) {
+	uint32_t micros = (IdleCounts * 3) / 5;
+
+	IdleCounts = 0;
+
+	return micros;
+}
+#endif
+
+/**
+ * @brief Put the core in idle until the next interrupt
+ *
+ * Timers and the other peripherals keep running, the 1ms tick is the
+ * latest the core wakes up. The time is counted as idle for the power
+ * statistics in raw Timer 3 counts, Tick_TakeIdleMicros() converts them.
+ */
+void Tick_Idle(void) {
+#if POWER_STATS_ENABLE
+	uint8_t startTicks;
+	uint8_t endTicks;
+	uint16_t start;
+	uint16_t end;
+
+	start = Tick_ReadCount(&startTicks);
+	PCON0 |= PCON0_IDLE__IDLE;
+	end = Tick_ReadCount(&endTicks);
+
+	// the tick wakes the core, so this rarely adds more than one
+	// millisecond and a multiply isn't worth it
+	for (endTicks -= startTicks; endTicks; endTicks--) {
+		end += TICK_COUNTS_PER_MS >> Shift;
+	}
+
+	IdleCounts += (uint32_t)(uint16_t)(end - start) << Shift;
+#else
+	PCON0 |= PCON0_IDLE__IDLE;
+#endif
 }
 
 /**
@@ -34,12 +200,177 @@ static uint16_t Tick_GetCount(void) {
  *
  * @param ms The number of milliseconds to wait
  *
- * @note this function is a blocking type
+ * @note this function is a blocking type, the core idles while it waits
  */
 void Tick_Wait(uint16_t ms) {
-    uint16_t ticks = Tick_GetCount();
+	uint32_t ticks = Tick_GetCount();
+
+	while (Tick_Elapsed(ticks) < ms) {
+		Tick_Idle();
+	}
+}
 
-    while ((Tick_GetCount() - ticks) < ms);
+/**
+ * @brief Set how long the core may sleep from now
+ *
+ * The low power code keeps the RTC alarm no later than this, so a task due
+ * before the next scan still runs on time.
+ *
+ * @param ms milliseconds from now, TICK_NO_LIMIT to let it sleep until the
+ * next scan
+ */
+void Tick_SetSleepLimit(uint16_t ms) {
+	SleepLimited = (ms != TICK_NO_LIMIT);
+	SleepDeadline = Tick_GetCount() + ms;
+}
+
+/**
+ * @brief Return the milliseconds left before the core must be awake
+ *
+ * @return 0 if the limit has passed, TICK_NO_LIMIT if there is none
+ */
+uint16_t Tick_GetSleepLimit(void) {
+	int32_t left;
+
+	if (!SleepLimited) {
+		return TICK_NO_LIMIT;
+	}
+
+	left = (int32_t)(SleepDeadline - Tick_GetCount());
+
+	if (left <= 0) {
+		return 0;
+	}
+
+	if (left >= TICK_NO_LIMIT) {
+		return TICK_NO_LIMIT - 1;
+	}
+
+	return (uint16_t)left;
+}
+
+/**
+ * @brief Stop the 1ms interrupt before the core goes to sleep
+ *
+ * Timer 3 stops with SYSCLK in sleep anyway, this only makes sure no
+ * pending overflow is left behind. An overflow that hasn't been serviced
+ * yet is counted here. The part of the millisecond already counted stays
+ * in the timer for Tick_Resume().
+ */
+void Tick_Suspend(void) {
+	EIE1 &= ~EIE1_ET3__BMASK;
+	TMR3CN0 &= ~TMR3CN0_TR3__BMASK;
+
+	if (TMR3CN0 & TMR3CN0_TF3H__BMASK) {
+		TMR3CN0 &= ~TMR3CN0_TF3H__BMASK;
+		Ticks++;
+	}
+
+	EIE1 |= EIE1_ET3__ENABLED;
+}
+
+/**
+ * @brief Restart the 1ms interrupt after sleep
+ *
+ * @param ms time spent asleep, measured by the RTC. The caller carries the
+ * part of a millisecond over to the next sleep.
+ */
+void Tick_Resume(uint16_t ms) {
+	// the interrupt can't fire while the timer is stopped
+	Ticks += ms;
+	Slept += (uint32_t)ms * 1000;
+
+	TMR3CN0 |= TMR3CN0_TR3__RUN;
+}
+
+/**
+ * @brief Move the tick on by the time the core was suspended for sensor
+ * conversions
+ *
+ * SYSCLK, and with it Timer 3, stops while the core is suspended. The low
+ * power code measures the missing time with the RTC at the end of each
+ * scan. Whole milliseconds go on the tick and the rest is carried over to
+ * the next scan.
+ *
+ * @param micros time suspended in microseconds
+ */
+void Tick_AddSuspend(uint16_t micros) {
+	uint16_t ms = 0;
+
+#if COMM_ENABLE
+	Suspended += micros;
+#endif
+
+	while (micros >= 1000) {
+		micros -= 1000;
+		ms++;
+	}
+
+	SuspendCarry += micros;
+
+	if (SuspendCarry >= 1000) {
+		SuspendCarry -= 1000;
+		ms++;
+	}
+
+	if (ms) {
+		EIE1 &= ~EIE1_ET3__BMASK;
+		Ticks += ms;
+		EIE1 |= EIE1_ET3__ENABLED;
+	}
+}
+
+/**
+ * @brief Return the microseconds the core spent asleep, so a wall time
+ * measured with Tick_GetMicros() can leave them out
+ *
+ * @note wraps with Tick_GetMicros(), take differences only
+ */
+uint32_t Tick_GetSleptMicros(void) {
+	return Slept;
+}
+
+#if COMM_ENABLE
+/**
+ * @brief Return the microseconds the core spent asleep or suspended for
+ * conversions
+ *
+ * @note wraps with Tick_GetMicros(), take differences only
+ */
+uint32_t Tick_GetStoppedMicros(void) {
+	return Slept + Suspended;
+}
+#endif
+
+/**
+ * @brief Rescale Timer 3 after SYSCLK changed
+ *
+ * The part of the millisecond left is converted to the new clock so the
+ * switch doesn't gain or lose time.
+ *
+ * @param shift the SYSCLK divider is now 1 << shift
+ *
+ * @note at a divider above 1 the millisecond is rounded to a whole number
+ * of counts, the tick runs up to 0.2% fast
+ */
+void Tick_SetClockShift(uint8_t shift) {
+	uint16_t left;
+
+	TMR3CN0 &= ~TMR3CN0_TR3__BMASK;
+
+	left = 0 - TMR3;
+
+	if (shift > Shift) {
+		left >>= shift - Shift;
+	} else {
+		left <<= Shift - shift;
+	}
+
+	Shift = shift;
+
+	TMR3 = 0 - left;
+	TMR3RL = TICK_CURRENT_RELOAD;
+	TMR3CN0 |= TMR3CN0_TR3__RUN;
 }
 
 /**
@@ -50,10 +381,10 @@ void Tick_Init(void) {
 	uint8_t TMR3CN0_TR3_save;
 	TMR3CN0_TR3_save = TMR3CN0 & TMR3CN0_TR3__BMASK;
 	TMR3CN0 &= ~(TMR3CN0_TR3__BMASK);
-	TMR3H = (0xF9 << TMR3H_TMR3H__SHIFT);
-	TMR3L = (0x7D << TMR3L_TMR3L__SHIFT);
-	TMR3RLH = (0xF9 << TMR3RLH_TMR3RLH__SHIFT);
-	TMR3RLL = (0x7D << TMR3RLL_TMR3RLL__SHIFT);
+	TMR3H = ((TICK_RELOAD >> 8) << TMR3H_TMR3H__SHIFT);
+	TMR3L = ((TICK_RELOAD & 0xFF) << TMR3L_TMR3L__SHIFT);
+	TMR3RLH = ((TICK_RELOAD >> 8) << TMR3RLH_TMR3RLH__SHIFT);
+	TMR3RLL = ((TICK_RELOAD & 0xFF) << TMR3RLL_TMR3RLL__SHIFT);
 	TMR3CN0 |= TMR3CN0_TR3__RUN;
 	TMR3CN0 |= TMR3CN0_TR3_save;
 
@@ -68,4 +399,6 @@ SI_INTERRUPT (TIMER3_ISR, TIMER3_IRQn) {
     TMR3CN0 &= ~TMR3CN0_TF3H__BMASK;
 
     Ticks++;
+
+    LedAnim_Tick();
 }
@@ -0,0 +1,159 @@
+/**
+ * @file touch_event.c
+ * @author Ronald Sousa www.hashDefineElectronics.com
+ * @date 19 Oct 2026
+ *
+ * Turns the button debounce state into a queue of timestamped events.
+ *
+ * Once a frame the debounce bits are compared with the previous frame.
+ * Edges become press and release events, a button kept down becomes hold
+ * and then repeat events, and a press soon after a release is also
+ * reported as a double tap.
+ */
+#include "main.h"
+#include "cslib_config.h"
+#include "cslib.h"
+#include "touch_event.h"
+
+/**
+ * value the frame counters stop at
+ */
+#define TOUCH_EVENT_FRAMES_MAX	0xFF
+
+/**
+ * The queue is emptied in the frame that fills it, so it is short enough to
+ * stay in internal RAM with the rest of the state
+ */
+static SI_SEGMENT_VARIABLE(Queue[TOUCH_EVENT_QUEUE_SIZE], TouchEvent_t, SI_SEG_IDATA);
+static uint8_t QueueHead = 0;
+static uint8_t QueueTail = 0;
+static uint8_t Dropped = 0;
+
+/**
+ * debounce bits from the last frame, a bit per button
+ */
+static uint8_t LastState = 0;
+
+/**
+ * frames each button has been down, or up since its last release
+ */
+static SI_SEGMENT_VARIABLE(Frames[TOUCH_EVENT_BUTTONS], uint8_t, SI_SEG_IDATA);
+
+/**
+ * @brief Add an event to the queue, dropping it if the queue is full
+ */
+static void TouchEvent_Push(uint8_t type, uint8_t button, uint16_t time) {
+	TouchEvent_t idata *event;
+
+	if ((uint8_t)(QueueHead - QueueTail) >= TOUCH_EVENT_QUEUE_SIZE) {
+		if (Dropped < 0xFF) {
+			Dropped++;
+		}
+		return;
+	}
+
+	event = &Queue[QueueHead & (TOUCH_EVENT_QUEUE_SIZE - 1)];
+	event->type = type;
+	event->button = button;
+	event->time = time;
+	QueueHead++;
+}
+
+/**
+ * @brief Start with every button up and an empty queue
+ */
+void TouchEvent_Init(void) {
+	uint8_t index;
+
+	for (index = 0; index < TOUCH_EVENT_BUTTONS; index++) {
+		Frames[index] = TOUCH_EVENT_FRAMES_MAX;
+	}
+
+	QueueHead = 0;
+	QueueTail = 0;
+	Dropped = 0;
+	LastState = 0;
+}
+
+/**
+ * @brief Read the button debounce state and queue what changed
+ *
+ * @note call once a frame, after CSLIB_update()
+ */
+void TouchEvent_Update(void) {
+	uint16_t time = (uint16_t)Tick_GetCount();
+	uint8_t state = 0;
+	uint8_t changed;
+	uint8_t button;
+	uint8_t mask;
+	uint8_t frames;
+
+	for (button = 0; button < TOUCH_EVENT_BUTTONS; button++) {
+		if (CSLIB_isSensorDebounceActive(TOUCH_EVENT_FIRST_SENSOR + button)) {
+			state |= 1 << button;
+		}
+	}
+
+	changed = state ^ LastState;
+	LastState = state;
+
+	for (button = 0, mask = 1; button < TOUCH_EVENT_BUTTONS; button++, mask <<= 1) {
+		frames = Frames[button];
+
+		if (changed & mask) {
+			if (state & mask) {
+				TouchEvent_Push(TOUCH_EVENT_PRESS, button, time);
+
+				// frames counts the time since the last release here
+				if (frames < TOUCH_EVENT_DOUBLE_FRAMES) {
+					TouchEvent_Push(TOUCH_EVENT_DOUBLE_TAP, button, time);
+				}
+			} else {
+				TouchEvent_Push(TOUCH_EVENT_RELEASE, button, time);
+			}
+
+			frames = 0;
+		} else if (frames < TOUCH_EVENT_FRAMES_MAX) {
+			frames++;
+
+			if (state & mask) {
+				if (frames == TOUCH_EVENT_HOLD_FRAMES) {
+					TouchEvent_Push(TOUCH_EVENT_HOLD, button, time);
+				} else if (frames == TOUCH_EVENT_HOLD_FRAMES + TOUCH_EVENT_REPEAT_FRAMES) {
+					TouchEvent_Push(TOUCH_EVENT_REPEAT, button, time);
+					frames = TOUCH_EVENT_HOLD_FRAMES;
+				}
+			}
+		}
+
+		Frames[button] = frames;
+	}
+}
+
+/**
+ * @brief Take the oldest event off the queue
+ *
+ * @return false if the queue is empty
+ */
+bool TouchEvent_Get(TouchEvent_t *event) {
+	TouchEvent_t idata *oldest;
+
+	if (QueueHead == QueueTail) {
+		return false;
+	}
+
+	oldest = &Queue[QueueTail & (TOUCH_EVENT_QUEUE_SIZE - 1)];
+	event->type = oldest->type;
+	event->button = oldest->button;
+	event->time = oldest->time;
+	QueueTail++;
+
+	return true;
+}
+
+/**
+ * @brief Return the number of events lost to a full queue
+ */
+uint8_t TouchEvent_GetDropped(void) {
+	return Dropped;
+}